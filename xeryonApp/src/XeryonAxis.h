@@ -7,6 +7,27 @@
 
 #include "XeryonStages.h"
 
+/**
+ * @brief Bit positions in the STAT word.
+ */
+enum XeryonStatusBit
+{
+    ampEnabledBit = 1,
+    forceZeroBit = 4,
+    motorOnBit = 5,
+    closedLoopBit = 6,
+    encoderAtIndexBit = 7,
+    encoderValidBit = 8,
+    searchingIndexBit = 9,
+    positionReachedBit = 10,
+    encoderErrorBit = 12,
+    scanningBit = 13,
+    atLeftEndBit = 14,
+    atRightEndBit = 15,
+    errorLimitBit = 16,
+    searchingOptimalFrequencyBit = 17
+};
+
 class XeryonAxis
 {
 public:
@@ -50,26 +71,10 @@ public:
 
     /**
      * @brief Set the status_ word.
+     * @details The individual bits are decoded on access.
      * @param[in] s status_ word
      */
-    void setStatus(int s)
-    {
-        status_ = s;
-        isAmpEnabled = (status_ & (1 << 1));
-        isForceZero = (status_ & (1 << 4));
-        isMotorOn = (status_ & (1 << 5));
-        isClosedLoop = (status_ & (1 << 6));
-        isEncoderAtIndex = (status_ & (1 << 7));
-        isEncoderValid = (status_ & (1 << 8));
-        isSearchingIndex = (status_ & (1 << 9));
-        isPositionReached = (status_ & (1 << 10));
-        isEncoderError = (status_ & (1 << 12));
-        isScanning = (status_ & (1 << 13));
-        isAtLeftEnd = (status_ & (1 << 14));
-        isAtRightEnd = (status_ & (1 << 15));
-        isErrorLimit = (status_ & (1 << 16));
-        isSearchingOptimalFrequency = (status_ & (1 << 17));
-    };
+    void setStatus(int s) { status_ = s; };
 
     /**
      * @brief get the status_ word.
@@ -81,44 +86,43 @@ public:
      * @brief Set the stage type.
      * @param[in] type stage type
      */
-    void setStage(std::string type) { stage = stages.getStage(type); };
+    void setStage(std::string type)
+    {
+        stage = stages.getStage(type);
+        stageType_ = type;
+    };
 
     /**
-     * @brief Gget the indivual status_ bits.
+     * @brief Get the stage type.
+     * @return stage type as configured, empty if not configured
      */
-    int getIsAmpEnabled() { return isAmpEnabled; }
-    int getIsForceZero() { return isForceZero; }
-    int getIsMotorOn() { return isMotorOn; }
-    int getIsClosedLoop() { return isClosedLoop; }
-    int getIsEncoderAtIndex() { return isEncoderAtIndex; }
-    int getIsEncoderValid() { return isEncoderValid; }
-    int getIsSearchingIndex() { return isSearchingIndex; }
-    int getIsPositionReached() { return isPositionReached; }
-    int getIsEncoderError() { return isEncoderError; }
-    int getIsScanning() { return isScanning; }
-    int getIsAtLeftEnd() { return isAtLeftEnd; }
-    int getIsAtRightEnd() { return isAtRightEnd; }
-    int getIsErrorLimit() { return isErrorLimit; }
-    int getIsSearchingOptimalFrequency() { return isSearchingOptimalFrequency; }
+    std::string getStageType() { return stageType_; };
+
+    /**
+     * @brief Get the indivual status_ bits.
+     */
+    int getIsAmpEnabled() { return bit(ampEnabledBit); }
+    int getIsForceZero() { return bit(forceZeroBit); }
+    int getIsMotorOn() { return bit(motorOnBit); }
+    int getIsClosedLoop() { return bit(closedLoopBit); }
+    int getIsEncoderAtIndex() { return bit(encoderAtIndexBit); }
+    int getIsEncoderValid() { return bit(encoderValidBit); }
+    int getIsSearchingIndex() { return bit(searchingIndexBit); }
+    int getIsPositionReached() { return bit(positionReachedBit); }
+    int getIsEncoderError() { return bit(encoderErrorBit); }
+    int getIsScanning() { return bit(scanningBit); }
+    int getIsAtLeftEnd() { return bit(atLeftEndBit); }
+    int getIsAtRightEnd() { return bit(atRightEndBit); }
+    int getIsErrorLimit() { return bit(errorLimitBit); }
+    int getIsSearchingOptimalFrequency() { return bit(searchingOptimalFrequencyBit); }
 
     std::shared_ptr<XeryonStage> stage = std::make_shared<XeryonStage>(false, "", 1, 1); // default initialization
 
 private:
-    uint status_;
-    bool isAmpEnabled;
-    bool isForceZero;
-    bool isMotorOn;
-    bool isClosedLoop;
-    bool isEncoderAtIndex;
-    bool isEncoderValid;
-    bool isSearchingIndex;
-    bool isPositionReached;
-    bool isEncoderError;
-    bool isScanning;
-    bool isAtLeftEnd;
-    bool isAtRightEnd;
-    bool isErrorLimit;
-    bool isSearchingOptimalFrequency;
+    std::string stageType_;
+    uint status_ = 0;
+
+    int bit(XeryonStatusBit b) { return (status_ >> b) & 1; };
 
     XeryonStages stages = XeryonStages();
 };
@@ -0,0 +1,27 @@
+#include "XeryonClient.h"
+
+std::vector<int32_t> XeryonClient::get(const std::vector<XDCmd> &cmds)
+{
+    std::vector<std::string> queries;
+    queries.reserve(cmds.size());
+    for (XDCmd cmd : cmds)
+    {
+        char buf[32];
+        xdEncodeQuery(cmd, buf, sizeof(buf));
+        queries.push_back(buf);
+    }
+
+    std::vector<std::string> replies;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        replies = transport_->writeReadBatch(queries);
+    }
+
+    std::vector<int32_t> values;
+    values.reserve(cmds.size());
+    for (size_t i = 0; i < cmds.size(); i++)
+    {
+        values.push_back(xdDecode(cmds[i], replies.at(i).c_str()));
+    }
+    return values;
+}
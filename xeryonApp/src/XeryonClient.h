@@ -0,0 +1,126 @@
+#ifndef XERYON_CLIENT_H
+#define XERYON_CLIENT_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "XeryonAxis.h"
+#include "XeryonCommands.h"
+#include "XeryonTransport.h"
+
+/**
+ * @brief XD protocol client, independent of EPICS.
+ * @details Encodes commands from the command table, decodes replies and serializes access to the transport.
+ * All methods are thread safe. Errors are reported as XeryonException.
+ */
+class XeryonClient
+{
+public:
+    explicit XeryonClient(std::shared_ptr<XeryonTransport> transport) : transport_(transport){};
+
+    /**
+     * @brief Set a command selected at run time, access and range are checked at run time.
+     */
+    void set(XDCmd cmd, int32_t value)
+    {
+        char buf[32];
+        xdEncode(cmd, buf, sizeof(buf), value);
+        write(buf);
+    };
+
+    /**
+     * @brief Set a command, access is checked at compile time, range at run time.
+     */
+    template <XDCmd cmd>
+    void set(int32_t value)
+    {
+        char buf[32];
+        xdEncode<cmd>(buf, sizeof(buf), value);
+        write(buf);
+    };
+
+    /**
+     * @brief Set a command to a constant, access and range are checked at compile time.
+     */
+    template <XDCmd cmd, int32_t value = 0>
+    void set()
+    {
+        char buf[32];
+        xdEncode<cmd, value>(buf, sizeof(buf));
+        write(buf);
+    };
+
+    /**
+     * @brief Query a command selected at run time.
+     */
+    int32_t get(XDCmd cmd)
+    {
+        char buf[32];
+        xdEncodeQuery(cmd, buf, sizeof(buf));
+        return xdDecode(cmd, writeRead(buf).c_str());
+    };
+
+    /**
+     * @brief Query a command, access is checked at compile time.
+     */
+    template <XDCmd cmd>
+    int32_t get()
+    {
+        char buf[32];
+        xdEncodeQuery<cmd>(buf, sizeof(buf));
+        return xdDecode(cmd, writeRead(buf).c_str());
+    };
+
+    /**
+     * @brief Query several commands in one batch, pipelined on stream transports.
+     * @return the values, in the order of cmds
+     */
+    std::vector<int32_t> get(const std::vector<XDCmd> &cmds);
+
+    /**
+     * @brief Query a command without blocking the caller.
+     */
+    std::future<int32_t> getAsync(XDCmd cmd)
+    {
+        return std::async(std::launch::async, [this, cmd]() { return get(cmd); });
+    };
+
+    /**
+     * @brief Query several commands without blocking the caller.
+     */
+    std::future<std::vector<int32_t>> getAsync(const std::vector<XDCmd> &cmds)
+    {
+        return std::async(std::launch::async, [this, cmds]() { return get(cmds); });
+    };
+
+    /**
+     * @brief Read STAT into an axis, which decodes the status bits.
+     */
+    void readStatus(XeryonAxis &axis) { axis.setStatus(get<XD_STAT>()); };
+
+    /**
+     * @brief Send a raw command line, no checks.
+     */
+    void write(const std::string &command)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        transport_->write(command);
+    };
+
+    /**
+     * @brief Send a raw command line and return the reply, no checks.
+     */
+    std::string writeRead(const std::string &command)
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return transport_->writeRead(command);
+    };
+
+private:
+    std::shared_ptr<XeryonTransport> transport_;
+    std::mutex mutex_;
+};
+
+#endif // XERYON_CLIENT_H
@@ -0,0 +1,213 @@
+#ifndef XERYON_COMMANDS_H
+#define XERYON_COMMANDS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "XeryonException.h"
+
+/**
+ * @class Exception class used for malformed commands and replies.
+ */
+class XeryonCommandException : public XeryonException
+{
+public:
+    XeryonCommandException(const std::string &description) : XeryonException(description) {}
+};
+
+/**
+ * @brief Access of a command.
+ */
+enum class XDAccess : uint8_t
+{
+    Read = 1,     /**< query only, "TAG=?" */
+    Write = 2,    /**< set only, "TAG=value" */
+    ReadWrite = 3 /**< query and set */
+};
+
+/**
+ * @brief When a command is queried by the poll engine.
+ */
+enum class XDPoll : uint8_t
+{
+    None,    /**< never polled */
+    Status,  /**< polled first in every cycle, drives the motor status bits */
+    Readback /**< polled in every cycle after the status */
+};
+
+/**
+ * @brief Descriptor of one ASCII command.
+ */
+struct XDCommandInfo
+{
+    const char *tag; /**< ASCII command */
+    int32_t min;     /**< smallest valid value */
+    int32_t max;     /**< largest valid value */
+    XDAccess access;
+    XDPoll poll;
+    bool hasParam;  /**< exposed as asyn parameter, named after the tag */
+    bool asynWrite; /**< writes to the asyn parameter are sent to the controller, readbacks are never written */
+};
+
+/**
+ * @brief Index into xdCommands, the order has to match the table.
+ */
+enum XDCmd : uint8_t
+{
+    XD_STAT,
+    XD_EPOS,
+    XD_TIME,
+    XD_DPOS,
+    XD_SSPD,
+    XD_FREQ,
+    XD_STEP,
+    XD_SCAN,
+    XD_INDX,
+    XD_ISPD,
+    XD_ACCE,
+    XD_PTOL,
+    XD_PTO2,
+    XD_ZERO,
+    XD_STOP,
+    XD_CONT,
+    XD_INFO,
+    XD_TEST,
+    XD_SOFT,
+    XD_SRNO,
+    XD_NUM_COMMANDS
+};
+
+constexpr int32_t bits26Min = -(1 << 25);
+constexpr int32_t bits26Max = (1 << 25) - 1;
+constexpr int32_t bits24Max = (1 << 24) - 1;
+constexpr int32_t bits16Max = (1 << 16) - 1;
+constexpr int32_t int32Min = INT32_MIN;
+constexpr int32_t int32Max = INT32_MAX;
+
+/**
+ * @brief Commands used by the driver, see XeryonCommands.adoc.
+ */
+constexpr XDCommandInfo xdCommands[XD_NUM_COMMANDS] = {
+    {"STAT", 0, (1 << 18) - 1, XDAccess::Read, XDPoll::Status, true, false},
+    {"EPOS", bits26Min, bits26Max, XDAccess::Read, XDPoll::Readback, true, false},
+    {"TIME", 0, int32Max, XDAccess::Read, XDPoll::Readback, true, false},
+    {"DPOS", bits26Min, bits26Max, XDAccess::ReadWrite, XDPoll::Readback, true, false},
+    {"SSPD", 0, bits24Max, XDAccess::ReadWrite, XDPoll::Readback, true, false},
+    {"FREQ", 0, bits24Max, XDAccess::Read, XDPoll::Readback, true, false},
+    {"STEP", bits26Min, bits26Max, XDAccess::Write, XDPoll::None, false, false},
+    {"SCAN", -1, 1, XDAccess::Write, XDPoll::None, false, false},
+    {"INDX", 0, 1, XDAccess::Write, XDPoll::None, true, true},
+    {"ISPD", 0, bits24Max, XDAccess::ReadWrite, XDPoll::None, false, false},
+    {"ACCE", 0, bits16Max, XDAccess::ReadWrite, XDPoll::None, false, false},
+    {"PTOL", 0, bits16Max, XDAccess::ReadWrite, XDPoll::None, true, true},
+    {"PTO2", 0, bits16Max, XDAccess::ReadWrite, XDPoll::None, true, true},
+    {"ZERO", 0, 1, XDAccess::Write, XDPoll::None, false, false},
+    {"STOP", 0, 1, XDAccess::Write, XDPoll::None, false, false},
+    {"CONT", 0, 1, XDAccess::Write, XDPoll::None, false, false},
+    {"INFO", 0, 6, XDAccess::Write, XDPoll::None, false, false},
+    {"TEST", 0, 1, XDAccess::Write, XDPoll::None, true, true},
+    {"SOFT", int32Min, int32Max, XDAccess::Read, XDPoll::None, false, false},
+    {"SRNO", int32Min, int32Max, XDAccess::Read, XDPoll::None, false, false},
+};
+
+constexpr bool xdTagIs(const char *a, const char *b)
+{
+    return (*a == *b) && (*a == '\0' || xdTagIs(a + 1, b + 1));
+}
+
+static_assert(xdTagIs(xdCommands[XD_STAT].tag, "STAT") && xdTagIs(xdCommands[XD_TIME].tag, "TIME") &&
+                  xdTagIs(xdCommands[XD_SRNO].tag, "SRNO"),
+              "xdCommands out of sync with XDCmd");
+
+constexpr bool xdCanRead(XDCmd cmd) { return static_cast<uint8_t>(xdCommands[cmd].access) & static_cast<uint8_t>(XDAccess::Read); }
+constexpr bool xdCanWrite(XDCmd cmd) { return static_cast<uint8_t>(xdCommands[cmd].access) & static_cast<uint8_t>(XDAccess::Write); }
+constexpr bool xdInRange(XDCmd cmd, int32_t value) { return value >= xdCommands[cmd].min && value <= xdCommands[cmd].max; }
+
+/**
+ * @brief Format "TAG=value" into buf, checking access and range at run time.
+ * @return number of characters written
+ */
+inline int xdEncode(XDCmd cmd, char *buf, size_t len, int32_t value)
+{
+    const XDCommandInfo &info = xdCommands[cmd];
+    if (!xdCanWrite(cmd))
+    {
+        throw XeryonCommandException(std::string(info.tag) + " is read only");
+    }
+    if (!xdInRange(cmd, value))
+    {
+        throw XeryonCommandException(std::string(info.tag) + "=" + std::to_string(value) + " out of range");
+    }
+    return snprintf(buf, len, "%s=%d", info.tag, value);
+}
+
+/**
+ * @brief Format "TAG=value", access is checked at compile time.
+ */
+template <XDCmd cmd>
+int xdEncode(char *buf, size_t len, int32_t value)
+{
+    static_assert(xdCanWrite(cmd), "command is read only");
+    return xdEncode(cmd, buf, len, value);
+}
+
+/**
+ * @brief Format "TAG=value" for a constant value, access and range are checked at compile time.
+ */
+template <XDCmd cmd, int32_t value>
+int xdEncode(char *buf, size_t len)
+{
+    static_assert(xdCanWrite(cmd), "command is read only");
+    static_assert(xdInRange(cmd, value), "value out of range");
+    return snprintf(buf, len, "%s=%d", xdCommands[cmd].tag, value);
+}
+
+/**
+ * @brief Format the query "TAG=?", access is checked at compile time.
+ */
+template <XDCmd cmd>
+int xdEncodeQuery(char *buf, size_t len)
+{
+    static_assert(xdCanRead(cmd), "command is write only");
+    return snprintf(buf, len, "%s=?", xdCommands[cmd].tag);
+}
+
+/**
+ * @brief Format the query "TAG=?" for a command selected at run time.
+ */
+inline int xdEncodeQuery(XDCmd cmd, char *buf, size_t len)
+{
+    if (!xdCanRead(cmd))
+    {
+        throw XeryonCommandException(std::string(xdCommands[cmd].tag) + " is write only");
+    }
+    return snprintf(buf, len, "%s=?", xdCommands[cmd].tag);
+}
+
+/**
+ * @brief Decode the value of a "TAG=value" reply.
+ * @details A reply with a different tag, e.g. a late reply to an earlier query, is rejected.
+ * @param[in] cmd the command the reply is expected for
+ * @param[in] reply the reply buffer
+ */
+inline int32_t xdDecode(XDCmd cmd, const char *reply)
+{
+    const char *tag = xdCommands[cmd].tag;
+    const char *eq = strchr(reply, '=');
+    if (!eq || size_t(eq - reply) != strlen(tag) || strncmp(reply, tag, eq - reply) != 0)
+    {
+        throw XeryonCommandException(std::string("unexpected reply to ") + tag + " (" + reply + ")");
+    }
+    char *end;
+    long value = strtol(eq + 1, &end, 10);
+    if (end == eq + 1)
+    {
+        throw XeryonCommandException(std::string("failed to decode reply to ") + tag + " (" + reply + ")");
+    }
+    return static_cast<int32_t>(value);
+}
+
+#endif // XERYON_COMMANDS_H
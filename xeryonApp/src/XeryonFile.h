@@ -0,0 +1,38 @@
+#ifndef XERYON_FILE_H
+#define XERYON_FILE_H
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Replace a text file without ever leaving it truncated.
+ * @details The content is written to fileName.tmp, which is then renamed over fileName.
+ * Failures are reported on std::cerr, the previous file is kept.
+ * @param[in] fileName path of the file
+ * @param[in] write writes the new content to the stream
+ * @return false if the file could not be written or replaced
+ */
+inline bool xdReplaceFile(const std::string &fileName, const std::function<void(std::ostream &)> &write)
+{
+    std::string tmpName = fileName + ".tmp";
+    {
+        std::ofstream file(tmpName, std::ios::trunc);
+        write(file);
+        if (!file)
+        {
+            std::cerr << "failed to write " << tmpName << '\n';
+            return false;
+        }
+    }
+    if (std::rename(tmpName.c_str(), fileName.c_str()) != 0)
+    {
+        std::cerr << "failed to replace " << fileName << '\n';
+        return false;
+    }
+    return true;
+}
+
+#endif // XERYON_FILE_H
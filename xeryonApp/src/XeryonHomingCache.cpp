@@ -0,0 +1,47 @@
+#include <fstream>
+
+#include "XeryonFile.h"
+#include "XeryonHomingCache.h"
+
+void XeryonHomingCache::open(const std::string &fileName)
+{
+    fileName_ = fileName;
+    entries_.clear();
+
+    std::ifstream file(fileName);
+    int axis;
+    XeryonHomingEntry entry;
+    while (file >> axis >> entry.serialNumber >> entry.stageType >> entry.indexValid)
+    {
+        if (entry.stageType == "-")
+            entry.stageType.clear();
+        entries_[axis] = entry;
+    }
+}
+
+bool XeryonHomingCache::get(int axis, XeryonHomingEntry &entry)
+{
+    auto it = entries_.find(axis);
+    if (it == entries_.end())
+        return false;
+    entry = it->second;
+    return true;
+}
+
+void XeryonHomingCache::set(int axis, const XeryonHomingEntry &entry)
+{
+    entries_[axis] = entry;
+    save();
+}
+
+void XeryonHomingCache::save()
+{
+    xdReplaceFile(fileName_, [this](std::ostream &file) {
+        for (auto &it : entries_)
+        {
+            file << it.first << " " << it.second.serialNumber << " "
+                 << (it.second.stageType.empty() ? "-" : it.second.stageType) << " "
+                 << it.second.indexValid << "\n";
+        }
+    });
+}
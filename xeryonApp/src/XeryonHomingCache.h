@@ -0,0 +1,53 @@
+#ifndef XERYON_HOMING_CACHE_H
+#define XERYON_HOMING_CACHE_H
+
+#include <map>
+#include <string>
+
+/**
+ * @brief Homing state of one axis as stored in the cache file.
+ */
+struct XeryonHomingEntry
+{
+    int serialNumber;      /**< controller serial number (SRNO) */
+    std::string stageType; /**< stage type from XDconfigureAxis */
+    bool indexValid;       /**< the controller holds a valid index for this stage */
+};
+
+/**
+ * @brief Persistent per-axis homing state of one controller.
+ * @details Plain text file, one line per axis: "axis serialNumber stageType indexValid".
+ * The file is rewritten on every change, which only happens when the index validity of an axis changes.
+ */
+class XeryonHomingCache
+{
+public:
+    XeryonHomingCache(){};
+
+    /**
+     * @brief Set the cache file and load its content, a missing file is an empty cache.
+     * @param[in] fileName path of the cache file
+     */
+    void open(const std::string &fileName);
+
+    bool isOpen() { return !fileName_.empty(); };
+
+    /**
+     * @brief Get the cached state of an axis.
+     * @return false if the axis is not in the cache
+     */
+    bool get(int axis, XeryonHomingEntry &entry);
+
+    /**
+     * @brief Store the state of an axis and rewrite the file.
+     */
+    void set(int axis, const XeryonHomingEntry &entry);
+
+private:
+    void save();
+
+    std::string fileName_;
+    std::map<int, XeryonHomingEntry> entries_;
+};
+
+#endif // XERYON_HOMING_CACHE_H
@@ -0,0 +1,143 @@
+#ifndef XERYON_MOTION_ESTIMATOR_H
+#define XERYON_MOTION_ESTIMATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Estimates velocity and move statistics from controller time stamped encoder samples.
+ * @details Samples are (TIME, EPOS) pairs, TIME in units of 0.1 ms.
+ * The velocity is the least squares slope over the last windowSize samples.
+ */
+class XeryonMotionEstimator
+{
+public:
+    static const size_t windowSize = 8;
+    static constexpr double tickSeconds = 1e-4; /**< resolution of TIME */
+
+    XeryonMotionEstimator(){};
+
+    /**
+     * @brief Forget all samples, e.g. after a wrap of the controller time.
+     */
+    void reset() { count_ = 0; };
+
+    /**
+     * @brief Add a sample.
+     * @param[in] time controller time stamp (TIME)
+     * @param[in] epos encoder position (EPOS)
+     */
+    void addSample(int32_t time, int32_t epos)
+    {
+        if (count_ > 0 && time <= newest().time)
+            reset();
+        head_ = (head_ + 1) % windowSize;
+        samples_[head_] = Sample{time, epos};
+        if (count_ < windowSize)
+            count_++;
+    };
+
+    /**
+     * @brief Velocity over the sample window.
+     * @return velocity in counts/s, 0 if less than two samples
+     */
+    double getVelocity()
+    {
+        if (count_ < 2)
+            return 0.;
+
+        // relative to the newest sample to keep the sums small
+        const Sample &ref = newest();
+        double st = 0., sp = 0., stt = 0., stp = 0.;
+        for (size_t i = 0; i < count_; i++)
+        {
+            const Sample &s = samples_[(head_ + windowSize - i) % windowSize];
+            double t = (s.time - ref.time) * tickSeconds;
+            double p = s.epos - ref.epos;
+            st += t;
+            sp += p;
+            stt += t * t;
+            stp += t * p;
+        }
+        double denom = count_ * stt - st * st;
+        return denom > 0. ? (count_ * stp - st * sp) / denom : 0.;
+    };
+
+    /**
+     * @brief Start collecting statistics of a move.
+     * @details The start time is the time stamp of the first sample added after the move was commanded.
+     * @param[in] target target position of the move
+     */
+    void startMove(int32_t target)
+    {
+        moving_ = true;
+        startPending_ = true;
+        target_ = target;
+        direction_ = (count_ == 0 || target >= newest().epos) ? 1 : -1;
+        overshoot_ = 0;
+    };
+
+    /**
+     * @brief Update the statistics of the running move with the newest sample.
+     * @param[in] positionReached position reached bit of the status word
+     * @return true if the move has just finished, the statistics are then valid
+     */
+    bool updateMove(bool positionReached)
+    {
+        if (!moving_ || count_ == 0)
+            return false;
+        // the first sample after the command marks the start, its status may still be the one of the previous move
+        if (startPending_)
+        {
+            startTime_ = newest().time;
+            startPending_ = false;
+            return false;
+        }
+        if (newest().time <= startTime_)
+            return false;
+
+        overshoot_ = std::max(overshoot_, (newest().epos - target_) * direction_);
+        if (!positionReached)
+            return false;
+
+        settleTime_ = (newest().time - startTime_) * tickSeconds;
+        moving_ = false;
+        return true;
+    };
+
+    /**
+     * @brief Time from the first poll after the move command until the position was reached.
+     * @return time in s, resolution is the poll period
+     */
+    double getSettleTime() { return settleTime_; };
+
+    /**
+     * @brief Largest overshoot past the target during the last move.
+     * @return overshoot in counts, 0 if the target was approached from one side only
+     */
+    int32_t getOvershoot() { return overshoot_; };
+
+private:
+    struct Sample
+    {
+        int32_t time;
+        int32_t epos;
+    };
+
+    const Sample &newest() { return samples_[head_]; };
+
+    std::array<Sample, windowSize> samples_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+
+    bool moving_ = false;
+    bool startPending_ = false; /**< the start time is taken from the next sample */
+    int32_t target_ = 0;
+    int32_t startTime_ = 0;
+    int32_t direction_ = 1;
+    int32_t overshoot_ = 0;
+    double settleTime_ = 0.;
+};
+
+#endif // XERYON_MOTION_ESTIMATOR_H
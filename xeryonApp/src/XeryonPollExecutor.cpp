@@ -0,0 +1,115 @@
+#include <cstdio>
+
+#include "XeryonPollExecutor.h"
+#include "XeryonXDController.h"
+
+void XDPollExecutor::start(int numThreads)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_ = false;
+    for (int i = workers_.size(); i < numThreads; i++)
+    {
+        workers_.emplace_back(&XDPollExecutor::worker, this);
+    }
+}
+
+void XDPollExecutor::add(XDController *controller)
+{
+    std::unique_ptr<Task> task(new Task());
+    task->controller = controller;
+    task->deadline = clock::now();
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    tasks_.push_back(std::move(task));
+    changed_.notify_one();
+}
+
+void XDPollExecutor::wakeup(XDController *controller, int forcedFastPolls)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto &task : tasks_)
+    {
+        if (task->controller != controller)
+            continue;
+        task->forcedFastPolls = forcedFastPolls;
+        if (task->busy)
+            task->woken = true;
+        else
+            task->deadline = clock::now();
+    }
+    changed_.notify_one();
+}
+
+void XDPollExecutor::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+        changed_.notify_all();
+    }
+    for (auto &worker : workers_)
+    {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void XDPollExecutor::report(FILE *fp)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    clock::time_point now = clock::now();
+    fprintf(fp, "XD shared poller: %zu threads, %zu controllers\n", workers_.size(), tasks_.size());
+    for (auto &task : tasks_)
+    {
+        fprintf(fp, "  %s: polls=%lu, next poll in %f s%s\n", task->controller->portName, task->polls,
+                std::chrono::duration<double>(task->deadline - now).count(), task->busy ? ", polling" : "");
+    }
+}
+
+void XDPollExecutor::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        // earliest deadline among the controllers not being polled by another worker
+        Task *next = nullptr;
+        for (auto &task : tasks_)
+        {
+            if (!task->busy && (!next || task->deadline < next->deadline))
+                next = task.get();
+        }
+        if (!next)
+        {
+            changed_.wait(lock);
+            continue;
+        }
+        if (next->deadline > clock::now())
+        {
+            changed_.wait_until(lock, next->deadline);
+            continue;
+        }
+
+        next->busy = true;
+        lock.unlock();
+        // the periods are read under the controller lock, never take it while holding mutex_
+        double movingPollPeriod, idlePollPeriod;
+        bool anyMoving = next->controller->pollAll(movingPollPeriod, idlePollPeriod);
+        lock.lock();
+        next->busy = false;
+        next->polls++;
+
+        if (next->woken)
+        {
+            next->woken = false;
+            next->deadline = clock::now();
+        }
+        else
+        {
+            double period = (anyMoving || next->forcedFastPolls > 0) ? movingPollPeriod : idlePollPeriod;
+            next->deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period));
+            if (next->forcedFastPolls > 0)
+                next->forcedFastPolls--;
+        }
+        changed_.notify_one();
+    }
+}
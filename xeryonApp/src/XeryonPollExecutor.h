@@ -0,0 +1,90 @@
+#ifndef XERYON_POLL_EXECUTOR_H
+#define XERYON_POLL_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class XDController;
+
+/**
+ * @class XDPollExecutor
+ * @brief Polls many controllers from a small pool of worker threads.
+ * @details Replaces the per-controller poller thread of asynMotorController when enabled with XDSharedPoller.
+ * Each controller is scheduled by its next poll deadline and is polled by at most one worker at a time,
+ * so all traffic for one asyn port stays serialized.
+ */
+class XDPollExecutor
+{
+public:
+    static XDPollExecutor &getInstance()
+    {
+        static XDPollExecutor instance;
+        return instance;
+    }
+
+    /**
+     * @brief Start the worker threads.
+     * @note Has to be called before the controllers are created.
+     * @param[in] numThreads number of worker threads
+     */
+    void start(int numThreads);
+
+    /**
+     * @brief Shared polling is used if the workers have been started.
+     */
+    bool isEnabled() { return !workers_.empty(); };
+
+    /**
+     * @brief Add a controller to the schedule, it is polled right away.
+     * @details The poll periods are read from the controller after every poll, so runtime changes apply.
+     * @param[in] controller the controller to poll
+     */
+    void add(XDController *controller);
+
+    /**
+     * @brief Poll a controller as soon as possible, then at the moving rate for forcedFastPolls cycles.
+     * @details Counterpart of asynMotorController::wakeupPoller.
+     */
+    void wakeup(XDController *controller, int forcedFastPolls);
+
+    /**
+     * @brief Stop and join the worker threads.
+     */
+    void stop();
+
+    /**
+     * @brief Print the schedule.
+     */
+    void report(FILE *fp);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    struct Task
+    {
+        XDController *controller;
+        clock::time_point deadline;
+        int forcedFastPolls;
+        bool busy;  /**< being polled by a worker */
+        bool woken; /**< wakeup while busy, poll again right after */
+        unsigned long polls;
+    };
+
+    XDPollExecutor(){};
+    XDPollExecutor(XDPollExecutor const &) = delete;
+    void operator=(XDPollExecutor const &) = delete;
+
+    void worker();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::unique_ptr<Task>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+#endif // XERYON_POLL_EXECUTOR_H
@@ -2,7 +2,9 @@
 #define XERYON_STAGES_H
 
 #include <cmath>
+#include <iostream>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 struct XeryonStage
@@ -0,0 +1,82 @@
+#ifndef XERYON_STATE_BLOCK_H
+#define XERYON_STATE_BLOCK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief State of all axes of one controller, one contiguous array per quantity.
+ * @details The axes copy their status word and positions into their element while polling,
+ * update() then detects changes over all axes in one pass for the controller-wide arrays.
+ * The status bits are not decoded here: each axis decodes its own copy of the status word, see XeryonAxis.
+ */
+struct XeryonStateBlock
+{
+    std::vector<int32_t> status; /**< status words */
+    std::vector<int32_t> epos;   /**< encoder positions */
+    std::vector<int32_t> dpos;   /**< target positions */
+
+    /**
+     * @brief Summary of one update().
+     */
+    struct Changes
+    {
+        bool status;    /**< any status word changed */
+        bool positions; /**< any encoder or target position changed */
+    };
+
+    /**
+     * @brief Size all arrays to the number of axes.
+     */
+    void resize(size_t numAxes)
+    {
+        status.assign(numAxes, 0);
+        epos.assign(numAxes, 0);
+        dpos.assign(numAxes, 0);
+        prevStatus_.assign(numAxes, 0);
+        prevEpos_.assign(numAxes, 0);
+        prevDpos_.assign(numAxes, 0);
+    };
+
+    size_t size() { return status.size(); };
+
+    /**
+     * @brief Detect the changes since the previous update() for all axes.
+     */
+    Changes update()
+    {
+        const size_t n = status.size();
+        uint32_t anyStatus = 0;
+        uint32_t anyPosition = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            anyStatus |= uint32_t(status[i] ^ prevStatus_[i]);
+            anyPosition |= uint32_t(epos[i] ^ prevEpos_[i]) | uint32_t(dpos[i] ^ prevDpos_[i]);
+        }
+        prevStatus_ = status;
+        prevEpos_ = epos;
+        prevDpos_ = dpos;
+        return Changes{anyStatus != 0, anyPosition != 0};
+    };
+
+    /**
+     * @brief Number of axes which have all bits of mask set.
+     */
+    size_t count(uint32_t mask)
+    {
+        size_t n = 0;
+        for (int32_t s : status)
+        {
+            n += (uint32_t(s) & mask) == mask;
+        }
+        return n;
+    };
+
+private:
+    std::vector<int32_t> prevStatus_;
+    std::vector<int32_t> prevEpos_;
+    std::vector<int32_t> prevDpos_;
+};
+
+#endif // XERYON_STATE_BLOCK_H
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "XeryonTrace.h"
+
+static const char traceMagic[4] = {'X', 'D', 'T', 'R'};
+static const uint8_t traceVersion = 1;
+
+void XeryonTraceRecorder::open(const std::string &fileName)
+{
+    close();
+    file_.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file_)
+    {
+        throw XeryonTraceException("Failed to open trace file " + fileName);
+    }
+    file_.write(traceMagic, sizeof(traceMagic));
+    file_.put(traceVersion);
+    start_ = std::chrono::steady_clock::now();
+    lastFlushNs_ = 0;
+}
+
+void XeryonTraceRecorder::close()
+{
+    if (file_.is_open())
+    {
+        file_.close();
+    }
+}
+
+void XeryonTraceRecorder::record(XeryonTraceEntry::Kind kind, const char *text)
+{
+    if (!file_.is_open())
+        return;
+
+    uint64_t timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    size_t len = std::min<size_t>(strlen(text), UINT8_MAX);
+    file_.write(reinterpret_cast<const char *>(&timeNs), sizeof(timeNs));
+    file_.put(kind);
+    file_.put(static_cast<char>(len));
+    file_.write(text, len);
+    if (timeNs - lastFlushNs_ >= flushIntervalNs)
+    {
+        file_.flush();
+        lastFlushNs_ = timeNs;
+    }
+}
+
+void XeryonTracePlayer::load(const std::string &fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    char magic[sizeof(traceMagic)];
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, traceMagic, sizeof(magic)) != 0 || file.get() != traceVersion)
+    {
+        throw XeryonTraceException("Not a valid trace file " + fileName);
+    }
+
+    entries_.clear();
+    cursor_ = 0;
+    mismatches_ = 0;
+    XeryonTraceEntry entry;
+    char buf[UINT8_MAX];
+    while (file.read(reinterpret_cast<char *>(&entry.timeNs), sizeof(entry.timeNs)))
+    {
+        int kind = file.get();
+        int len = file.get();
+        if (len < 0 || !file.read(buf, len))
+        {
+            std::cerr << "truncated trace file " << fileName << ", " << entries_.size() << " entries loaded\n";
+            break;
+        }
+        entry.kind = static_cast<XeryonTraceEntry::Kind>(kind);
+        entry.text.assign(buf, len);
+        entries_.push_back(entry);
+    }
+}
+
+const XeryonTraceEntry *XeryonTracePlayer::nextCommand(const char *text)
+{
+    size_t commands = 0;
+    for (size_t i = cursor_; i < entries_.size() && commands < maxResync; i++)
+    {
+        // replies are matched by writeRead
+        if (entries_[i].kind == XeryonTraceEntry::Reply)
+            continue;
+        if (entries_[i].text == text)
+        {
+            if (commands > 0)
+                mismatches_++;
+            cursor_ = i + 1;
+            return &entries_[i];
+        }
+        commands++;
+    }
+    mismatches_++;
+    return nullptr;
+}
+
+bool XeryonTracePlayer::write(const char *text)
+{
+    return nextCommand(text) != nullptr;
+}
+
+bool XeryonTracePlayer::writeRead(const char *text, std::string &reply)
+{
+    const XeryonTraceEntry *cmd = nextCommand(text);
+    if (cmd == nullptr || cmd->kind != XeryonTraceEntry::Query || cursor_ >= entries_.size() ||
+        entries_[cursor_].kind != XeryonTraceEntry::Reply)
+        return false;
+
+    const XeryonTraceEntry &rep = entries_[cursor_++];
+    // keep the recorded controller latency
+    std::this_thread::sleep_for(std::chrono::nanoseconds(rep.timeNs - cmd->timeNs));
+    reply = rep.text;
+    return true;
+}
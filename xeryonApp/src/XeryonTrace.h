@@ -0,0 +1,134 @@
+#ifndef XERYON_TRACE_H
+#define XERYON_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "XeryonException.h"
+
+/**
+ * @class Exception class used for exceptions related to trace files.
+ */
+class XeryonTraceException : public XeryonException
+{
+public:
+    XeryonTraceException(const std::string &description) : XeryonException(description) {}
+};
+
+/**
+ * @brief One entry of a controller trace.
+ */
+struct XeryonTraceEntry
+{
+    enum Kind : uint8_t
+    {
+        Write = 'W', /**< command without reply */
+        Query = 'Q', /**< command expecting a reply */
+        Reply = 'R'  /**< reply to the preceding query */
+    };
+    uint64_t timeNs; /**< time since start of the trace in ns */
+    Kind kind;
+    std::string text;
+};
+
+/**
+ * @brief Records controller traffic to a binary trace file.
+ * @details File layout: magic "XDTR", uint8 version, then per entry
+ * uint64 time [ns], uint8 kind, uint8 length, length bytes of text (no EOS).
+ * Integers are stored in host byte order.
+ * The file is flushed at least once per flushInterval, so a crash loses at most the last second of traffic.
+ */
+class XeryonTraceRecorder
+{
+public:
+    static constexpr uint64_t flushIntervalNs = 1000000000; /**< flush interval of the trace file */
+
+    XeryonTraceRecorder(){};
+
+    /**
+     * @brief Open the trace file, any previous content is overwritten.
+     * @param[in] fileName path of the trace file
+     */
+    void open(const std::string &fileName);
+
+    /**
+     * @brief Flush and close the trace file.
+     */
+    void close();
+
+    bool isOpen() { return file_.is_open(); };
+
+    /**
+     * @brief Append one entry, time stamped now.
+     * @param[in] kind entry kind
+     * @param[in] text command or reply text
+     */
+    void record(XeryonTraceEntry::Kind kind, const char *text);
+
+private:
+    std::ofstream file_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t lastFlushNs_ = 0; /**< time of the last flush since start of the trace */
+};
+
+/**
+ * @brief Plays a trace back as a stand-in for the controller.
+ * @details Each query is answered with the recorded reply after the recorded controller latency,
+ * so the driver sees the same link timing as in the original session.
+ * A command that differs from the next recorded one is searched for within the next maxResync commands;
+ * recorded commands skipped on the way are dropped. A command not found there fails and consumes nothing,
+ * so a trace started after the controller was created still replays from its first poll.
+ */
+class XeryonTracePlayer
+{
+public:
+    static const size_t maxResync = 64; /**< recorded commands searched for a mismatched command */
+
+    XeryonTracePlayer(){};
+
+    /**
+     * @brief Load a trace file recorded by XeryonTraceRecorder.
+     * @details An empty trace is valid, every command then fails as exhausted.
+     * @param[in] fileName path of the trace file
+     */
+    void load(const std::string &fileName);
+
+    /**
+     * @brief Consume a command without reply.
+     * @param[in] text command as sent by the driver
+     * @return false if the command is not found in the trace
+     */
+    bool write(const char *text);
+
+    /**
+     * @brief Consume a query and return its recorded reply.
+     * @param[in] text command as sent by the driver
+     * @param[out] reply recorded reply
+     * @return false if the command or its reply is not found in the trace
+     */
+    bool writeRead(const char *text, std::string &reply);
+
+    /**
+     * @brief Number of commands which differed from the next recorded one.
+     */
+    size_t getMismatches() { return mismatches_; };
+
+    size_t getPosition() { return cursor_; };
+    size_t getSize() { return entries_.size(); };
+
+private:
+    /**
+     * @brief Advance to the recorded command matching the driver's command.
+     * @return the recorded command, nullptr if not found within maxResync commands
+     */
+    const XeryonTraceEntry *nextCommand(const char *text);
+
+    std::vector<XeryonTraceEntry> entries_;
+    size_t cursor_ = 0;
+    size_t mismatches_ = 0;
+};
+
+#endif // XERYON_TRACE_H
@@ -0,0 +1,171 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "XeryonTransport.h"
+
+XeryonStreamTransport::~XeryonStreamTransport()
+{
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+void XeryonStreamTransport::flush()
+{
+    buffer_.clear();
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    char buf[256];
+    while (::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN))
+    {
+        if (::read(fd_, buf, sizeof(buf)) <= 0)
+            break;
+    }
+}
+
+void XeryonStreamTransport::send(const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t n = ::write(fd_, data.data() + sent, data.size() - sent);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw XeryonTransportException(std::string("write failed: ") + strerror(errno));
+        }
+        sent += n;
+    }
+}
+
+std::string XeryonStreamTransport::readLine()
+{
+    size_t eos;
+    while ((eos = buffer_.find('\n')) == std::string::npos)
+    {
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, static_cast<int>(timeout_ * 1000));
+        if (ready == 0)
+            throw XeryonTransportException("timeout waiting for reply");
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw XeryonTransportException(std::string("poll failed: ") + strerror(errno));
+        }
+
+        char buf[256];
+        ssize_t n = ::read(fd_, buf, sizeof(buf));
+        if (n <= 0)
+            throw XeryonTransportException("connection closed");
+        buffer_.append(buf, n);
+    }
+
+    std::string line = buffer_.substr(0, eos);
+    buffer_.erase(0, eos + 1);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    return line;
+}
+
+void XeryonStreamTransport::write(const std::string &command)
+{
+    flush();
+    send(command + "\n");
+}
+
+std::string XeryonStreamTransport::writeRead(const std::string &command)
+{
+    flush();
+    send(command + "\n");
+    return readLine();
+}
+
+std::vector<std::string> XeryonStreamTransport::writeReadBatch(const std::vector<std::string> &commands)
+{
+    // all queries in one write, the controller answers them in order
+    std::string data;
+    for (auto &command : commands)
+    {
+        data += command + "\n";
+    }
+    flush();
+    send(data);
+
+    std::vector<std::string> replies;
+    replies.reserve(commands.size());
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        replies.push_back(readLine());
+    }
+    return replies;
+}
+
+XeryonSerialTransport::XeryonSerialTransport(const std::string &device)
+{
+    fd_ = open(device.c_str(), O_RDWR | O_NOCTTY);
+    if (fd_ < 0)
+        throw XeryonTransportException("cannot open " + device + ": " + strerror(errno));
+
+    struct termios tio;
+    memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if (tcsetattr(fd_, TCSANOW, &tio) != 0)
+        throw XeryonTransportException("cannot configure " + device + ": " + strerror(errno));
+}
+
+XeryonTcpTransport::XeryonTcpTransport(const std::string &host, int port)
+{
+    struct addrinfo hints;
+    struct addrinfo *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int err = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result);
+    if (err != 0)
+        throw XeryonTransportException("cannot resolve " + host + ": " + gai_strerror(err));
+
+    for (struct addrinfo *ai = result; ai != NULL && fd_ < 0; ai = ai->ai_next)
+    {
+        fd_ = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd_ >= 0 && connect(fd_, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd_ < 0)
+        throw XeryonTransportException("cannot connect to " + host + ":" + std::to_string(port));
+}
+
+void XeryonMemoryTransport::write(const std::string &command)
+{
+    writeRead(command);
+}
+
+std::string XeryonMemoryTransport::writeRead(const std::string &command)
+{
+    log_.push_back(command);
+
+    std::string reply;
+    if (handler_ && handler_(command, reply))
+        return reply;
+
+    size_t eq = command.find('=');
+    std::string tag = command.substr(0, eq);
+    if (eq != std::string::npos && command.compare(eq + 1, std::string::npos, "?") != 0)
+    {
+        values_[tag] = atoi(command.c_str() + eq + 1);
+    }
+    return tag + "=" + std::to_string(values_[tag]);
+}
@@ -0,0 +1,150 @@
+#ifndef XERYON_TRANSPORT_H
+#define XERYON_TRANSPORT_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "XeryonException.h"
+
+/**
+ * @class Exception class used for communication failures.
+ */
+class XeryonTransportException : public XeryonException
+{
+public:
+    XeryonTransportException(const std::string &description) : XeryonException(description) {}
+};
+
+/**
+ * @brief Line based link to a XD controller.
+ * @details Commands and replies are passed without end of string, the transport adds and strips "\n".
+ */
+class XeryonTransport
+{
+public:
+    virtual ~XeryonTransport(){};
+
+    /**
+     * @brief Send a command without reply.
+     */
+    virtual void write(const std::string &command) = 0;
+
+    /**
+     * @brief Send a command and wait for its reply.
+     */
+    virtual std::string writeRead(const std::string &command) = 0;
+
+    /**
+     * @brief Send several queries and collect their replies, in order.
+     * @details The default sends them one by one, stream transports send all queries before reading the replies.
+     */
+    virtual std::vector<std::string> writeReadBatch(const std::vector<std::string> &commands)
+    {
+        std::vector<std::string> replies;
+        replies.reserve(commands.size());
+        for (auto &command : commands)
+        {
+            replies.push_back(writeRead(command));
+        }
+        return replies;
+    };
+};
+
+/**
+ * @brief Transport over a POSIX file descriptor, base of the serial and TCP transports.
+ * @details Pending input is discarded before every command, like the asyn octet writeRead,
+ * so a reply arriving after its query timed out is never taken as the reply to the next query.
+ */
+class XeryonStreamTransport : public XeryonTransport
+{
+public:
+    ~XeryonStreamTransport();
+
+    void write(const std::string &command);
+    std::string writeRead(const std::string &command);
+    std::vector<std::string> writeReadBatch(const std::vector<std::string> &commands);
+
+    /**
+     * @brief Set the reply timeout.
+     * @param[in] timeout timeout in s
+     */
+    void setTimeout(double timeout) { timeout_ = timeout; };
+
+protected:
+    XeryonStreamTransport(){};
+
+    /**
+     * @brief Discard buffered and pending input, without waiting.
+     */
+    void flush();
+    void send(const std::string &data);
+    std::string readLine();
+
+    int fd_ = -1;
+    double timeout_ = 1.;
+    std::string buffer_; /**< received, not yet consumed data */
+};
+
+/**
+ * @brief Transport over a serial port (USB), 115200 baud 8N1.
+ */
+class XeryonSerialTransport : public XeryonStreamTransport
+{
+public:
+    /**
+     * @param[in] device serial device, e.g. /dev/ttyACM0
+     */
+    explicit XeryonSerialTransport(const std::string &device);
+};
+
+/**
+ * @brief Transport over TCP.
+ */
+class XeryonTcpTransport : public XeryonStreamTransport
+{
+public:
+    /**
+     * @param[in] host host name or address
+     * @param[in] port TCP port
+     */
+    XeryonTcpTransport(const std::string &host, int port);
+};
+
+/**
+ * @brief In memory stand-in for a controller, for tests and benchmarks of the protocol layer.
+ * @details Stores every "TAG=value" and answers "TAG=?" with the stored value ("TAG=0" if never set).
+ * A handler can override the reply of any command.
+ */
+class XeryonMemoryTransport : public XeryonTransport
+{
+public:
+    /**
+     * @brief Optional handler, returns true and sets reply to answer a command itself.
+     */
+    typedef std::function<bool(const std::string &command, std::string &reply)> Handler;
+
+    XeryonMemoryTransport(){};
+    explicit XeryonMemoryTransport(Handler handler) : handler_(handler){};
+
+    void write(const std::string &command);
+    std::string writeRead(const std::string &command);
+
+    /**
+     * @brief Set the value returned for a tag, e.g. STAT.
+     */
+    void setValue(const std::string &tag, int value) { values_[tag] = value; };
+
+    /**
+     * @brief Commands received so far.
+     */
+    const std::vector<std::string> &getLog() { return log_; };
+
+private:
+    Handler handler_;
+    std::map<std::string, int> values_;
+    std::vector<std::string> log_;
+};
+
+#endif // XERYON_TRANSPORT_H
@@ -0,0 +1,38 @@
+#include <fstream>
+
+#include "XeryonFile.h"
+#include "XeryonTuning.h"
+
+void XeryonTuningStore::load(const std::string &fileName)
+{
+    fileName_ = fileName;
+    results_.clear();
+
+    std::ifstream file(fileName);
+    std::string stageType;
+    XeryonTuningResult result;
+    while (file >> stageType >> result.ptol >> result.settleTime >> result.maxError)
+    {
+        results_[stageType] = result;
+    }
+}
+
+bool XeryonTuningStore::get(const std::string &stageType, XeryonTuningResult &result)
+{
+    auto it = results_.find(stageType);
+    if (it == results_.end())
+        return false;
+    result = it->second;
+    return true;
+}
+
+void XeryonTuningStore::set(const std::string &stageType, const XeryonTuningResult &result)
+{
+    results_[stageType] = result;
+    xdReplaceFile(fileName_, [this](std::ostream &file) {
+        for (auto &it : results_)
+        {
+            file << it.first << " " << it.second.ptol << " " << it.second.settleTime << " " << it.second.maxError << "\n";
+        }
+    });
+}
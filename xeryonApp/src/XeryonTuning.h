@@ -0,0 +1,48 @@
+#ifndef XERYON_TUNING_H
+#define XERYON_TUNING_H
+
+#include <map>
+#include <string>
+
+/**
+ * @brief Result of a positioning tolerance tuning run.
+ */
+struct XeryonTuningResult
+{
+    int ptol;          /**< positioning tolerance (PTOL) */
+    double settleTime; /**< mean time from DPOS to position reached in s */
+    int maxError;      /**< largest error in counts, read after a hold time past position reached */
+};
+
+/**
+ * @brief Tuning results per stage type, kept in a plain text file.
+ * @details One line per stage type: "stageType ptol settleTime maxError".
+ */
+class XeryonTuningStore
+{
+public:
+    XeryonTuningStore(){};
+
+    /**
+     * @brief Load the file, a missing file is an empty store.
+     * @param[in] fileName path of the tuning file
+     */
+    void load(const std::string &fileName);
+
+    /**
+     * @brief Get the result for a stage type.
+     * @return false if the stage type has not been tuned
+     */
+    bool get(const std::string &stageType, XeryonTuningResult &result);
+
+    /**
+     * @brief Store the result for a stage type and rewrite the file.
+     */
+    void set(const std::string &stageType, const XeryonTuningResult &result);
+
+private:
+    std::string fileName_;
+    std::map<std::string, XeryonTuningResult> results_;
+};
+
+#endif // XERYON_TUNING_H
@@ -11,6 +11,11 @@
 #include "XeryonXDAxis.h"
 #include "XeryonAxis.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+
 // These are the XDAxis methods
 
 XDAxis::XDAxis(XDController *pC, int axisNo)
@@ -22,7 +27,7 @@ XDAxis::XDAxis(XDController *pC, int axisNo)
   try
   {
     // stop unsolicited data transfer
-    pC_->setParameter(this->pC_, "INFO", 0);
+    pC_->setParameter<XD_INFO, 0>(this->pC_);
     callParamCallbacks();
   }
   catch (const std::exception &e)
@@ -51,17 +56,21 @@ asynStatus XDAxis::move(double position, int relative, double minVelocity, doubl
   try
   {
     int velocity = (int)(maxVelocity * this->getResolution() * this->getVelocityFactor());
-    pC_->setParameter(this->pC_, "SSPD", velocity);
+    pC_->setParameter<XD_SSPD>(this->pC_, velocity);
 
     // set absolute or relative movement target
+    int target = relative ? pC_->state_.dpos[axisNo_] + (int)position : (int)position;
     if (relative)
     {
-      pC_->setParameter(this->pC_, "STEP", (int)position);
+      pC_->setParameter<XD_STEP>(this->pC_, (int)position);
     }
     else
     {
-      pC_->setParameter(this->pC_, "DPOS", (int)position);
+      pC_->setParameter<XD_DPOS>(this->pC_, (int)position);
     }
+
+    // the settle time starts at the TIME sample of the next poll, no extra query here
+    estimator_.startMove(target);
   }
   catch (const std::exception &e)
   {
@@ -76,10 +85,21 @@ asynStatus XDAxis::home(double minVelocity, double maxVelocity, double accelerat
 {
   asynStatus status = asynSuccess;
 
+  if (indexTrusted_ && this->getIsEncoderValid())
+  {
+    asynPrint(this->pC_->pasynUserSelf, ASYN_TRACE_ERROR,
+              "XDAxis::home: axis %d index still valid, skipping index search\n", axisNo_);
+    return status;
+  }
+
   try
   {
+    // referencing velocity from HVEL, same scaling as SSPD in move()
+    int velocity = (int)(maxVelocity * this->getResolution() * this->getVelocityFactor());
+    pC_->setParameter<XD_ISPD>(this->pC_, velocity);
+
     // Begin move
-    pC_->setParameter(this->pC_, "INDX", forwards);
+    pC_->setParameter<XD_INDX>(this->pC_, forwards);
   }
   catch (const std::exception &e)
   {
@@ -94,10 +114,15 @@ asynStatus XDAxis::stop(double acceleration)
 {
   asynStatus status = asynSuccess;
 
+  // no further target from a step scan or PTOL tuning on this axis
+  abortMeasure_ = true;
+  if (pC_->scanRunning_ && pC_->scanAxis_ == axisNo_)
+    pC_->abortScan();
+
   try
   {
     // Force the piezo signals to zero volt
-    pC_->setParameter(this->pC_, "ZERO");
+    pC_->setParameter<XD_ZERO>(this->pC_);
   }
   catch (const std::exception &e)
   {
@@ -116,9 +141,11 @@ asynStatus XDAxis::poll(bool *moving)
   try
   {
     // Read the channel state
-    pC_->getParameter(this->pC_, "STAT", reply);
-    setIntegerParam(pC_->statrb_, reply);
+    pC_->getParameter<XD_STAT>(this->pC_, reply);
+    setIntegerParam(pC_->cmdParam_[XD_STAT], reply);
+    pC_->state_.status[axisNo_] = reply;
     this->setStatus(reply);
+    updateHomingCache();
 
     *moving = !this->getIsPositionReached();
     setIntegerParam(pC_->motorStatusDone_, ((this->getIsPositionReached()) || (this->getIsForceZero())));
@@ -132,23 +159,41 @@ asynStatus XDAxis::poll(bool *moving)
     setIntegerParam(pC_->motorStatusProblem_, this->getIsErrorLimit());
     setIntegerParam(pC_->motorStatusAtHome_, this->getIsEncoderAtIndex());
 
-    // Read the encoder position
-    pC_->getParameter(this->pC_, "EPOS", reply);
-    setDoubleParam(pC_->motorEncoderPosition_, (double)reply);
-    setIntegerParam(pC_->eposrb_, reply);
-
-    // Read the current theoretical position
-    pC_->getParameter(this->pC_, "DPOS", reply);
-    setDoubleParam(pC_->motorPosition_, reply);
-    setIntegerParam(pC_->dposrb_, reply);
+    // Read the readbacks from the command table (EPOS, TIME, DPOS, SSPD, FREQ)
+    for (int c = 0; c < XD_NUM_COMMANDS; c++)
+    {
+      XDCmd cmd = XDCmd(c);
+      if (xdCommands[cmd].poll != XDPoll::Readback)
+        continue;
 
-    // Read the current velocity setpoint
-    pC_->getParameter(this->pC_, "SSPD", reply);
-    setIntegerParam(pC_->sspdrb_, reply);
+      pC_->getParameter(this->pC_, cmd, reply);
+      setIntegerParam(pC_->cmdParam_[cmd], reply);
+      if (cmd == XD_EPOS)
+      {
+        // encoder position
+        setDoubleParam(pC_->motorEncoderPosition_, (double)reply);
+        pC_->state_.epos[axisNo_] = reply;
+      }
+      else if (cmd == XD_DPOS)
+      {
+        // current theoretical position
+        setDoubleParam(pC_->motorPosition_, reply);
+        pC_->state_.dpos[axisNo_] = reply;
+      }
+      else if (cmd == XD_TIME)
+      {
+        estimator_.addSample(reply, pC_->state_.epos[axisNo_]);
+      }
+    }
 
-    // Read the current exitation frequency
-    pC_->getParameter(this->pC_, "FREQ", reply);
-    setIntegerParam(pC_->freqrb_, reply);
+    // Estimates from the time stamped encoder samples
+    setDoubleParam(pC_->velo_, estimator_.getVelocity());
+    setIntegerParam(pC_->remaining_, pC_->state_.dpos[axisNo_] - pC_->state_.epos[axisNo_]);
+    if (estimator_.updateMove(this->getIsPositionReached()))
+    {
+      setDoubleParam(pC_->settle_, estimator_.getSettleTime());
+      setIntegerParam(pC_->overshoot_, estimator_.getOvershoot());
+    }
   }
   catch (const std::exception &e)
   {
@@ -157,5 +202,206 @@ asynStatus XDAxis::poll(bool *moving)
   }
   setIntegerParam(pC_->motorStatusProblem_, comStatus ? 1 : 0);
   callParamCallbacks();
+
+  // the last axis completes the controller-wide snapshot
+  if (axisNo_ == pC_->numAxes_ - 1)
+  {
+    pC_->publishSnapshot();
+  }
   return comStatus ? asynError : asynSuccess;
 }
+
+void XDAxis::updateHomingCache()
+{
+  if (!pC_->homingCache_.isOpen())
+    return;
+
+  bool valid = this->getIsEncoderValid();
+  bool searching = this->getIsSearchingIndex();
+  if (indexChecked_)
+  {
+    // an index found in this session is trusted: the valid bit rose, or an index search finished with it set
+    bool found = valid && (!lastIndexValid_ || (indexSearchSeen_ && !searching));
+    bool trusted = valid && (indexTrusted_ || found);
+    lastIndexValid_ = valid;
+    indexSearchSeen_ = searching || (indexSearchSeen_ && !found);
+    if (trusted == indexTrusted_)
+      return;
+    indexTrusted_ = trusted;
+  }
+  else
+  {
+    XeryonHomingEntry cached;
+    indexTrusted_ = valid && pC_->homingCache_.get(axisNo_, cached) && cached.indexValid &&
+                    cached.serialNumber == pC_->serialNumber_ && cached.stageType == this->getStageType();
+    indexChecked_ = true;
+    lastIndexValid_ = valid;
+    indexSearchSeen_ = searching;
+    asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::updateHomingCache: axis %d %s\n", axisNo_,
+              indexTrusted_ ? "index still valid, homing not required" : "homing required");
+  }
+
+  XeryonHomingEntry entry{pC_->serialNumber_, this->getStageType(), indexTrusted_};
+  pC_->homingCache_.set(axisNo_, entry);
+}
+
+void XDAxis::forgetIndex()
+{
+  indexTrusted_ = false;
+  asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::forgetIndex: axis %d homing required\n", axisNo_);
+  if (!pC_->homingCache_.isOpen())
+    return;
+
+  XeryonHomingEntry entry{pC_->serialNumber_, this->getStageType(), false};
+  pC_->homingCache_.set(axisNo_, entry);
+}
+
+bool XDAxis::measureMove(int target, double timeout, double &seconds, int &epos)
+{
+  int reply = 0;
+  int ptol = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  try
+  {
+    pC_->lock();
+    if (abortMeasure_)
+    {
+      pC_->unlock();
+      return false;
+    }
+    pC_->getParameter<XD_PTOL>(this->pC_, ptol);
+    pC_->setParameter<XD_DPOS>(this->pC_, target);
+    pC_->unlock();
+    // the position reached bit may still be set from the previous target,
+    // only accept it together with an encoder position inside PTOL
+    for (;;)
+    {
+      seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if (seconds > timeout || abortMeasure_)
+        return false;
+      pC_->lock();
+      pC_->getParameter<XD_STAT>(this->pC_, reply);
+      pC_->unlock();
+      if (!(reply & (1 << positionReachedBit)))
+        continue;
+      pC_->lock();
+      pC_->getParameter<XD_EPOS>(this->pC_, reply);
+      pC_->unlock();
+      if (std::abs(reply - target) <= ptol)
+        break;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    pC_->unlock();
+    asynPrint(this->pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::measureMove: %s\n", e.what());
+    return false;
+  }
+  epos = reply;
+  return true;
+}
+
+bool XDAxis::tunePositionTolerance(const std::vector<int> &candidates, int accuracy, int step, int repeats, XeryonTuningResult &best)
+{
+  const double timeout = 10.;
+  const double holdTime = 0.2; // settling after position reached, before the final error is read
+  int originalPtol = 0;
+  int origin = 0;
+
+  try
+  {
+    pC_->lock();
+    pC_->getParameter<XD_PTOL>(this->pC_, originalPtol);
+    pC_->getParameter<XD_DPOS>(this->pC_, origin);
+    pC_->unlock();
+  }
+  catch (const std::exception &e)
+  {
+    pC_->unlock();
+    asynPrint(this->pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::tunePositionTolerance: %s\n", e.what());
+    return false;
+  }
+
+  best = XeryonTuningResult{originalPtol, std::numeric_limits<double>::infinity(), 0};
+  bool found = false;
+  abortMeasure_ = false;
+  std::cout << "axis " << axisNo_ << ": PTOL, mean settle time [s], max error [counts]\n";
+  for (int ptol : candidates)
+  {
+    XeryonTuningResult result{ptol, 0., 0};
+    bool ok = true;
+    try
+    {
+      pC_->lock();
+      pC_->setParameter<XD_PTOL>(this->pC_, ptol);
+      pC_->unlock();
+    }
+    catch (const std::exception &e)
+    {
+      pC_->unlock();
+      std::cout << ptol << ": " << e.what() << "\n";
+      continue;
+    }
+
+    // out and back, so every candidate ends at the origin
+    for (int i = 0; ok && i < repeats; i++)
+    {
+      double seconds;
+      int epos;
+      int target = (i % 2) ? origin : origin + step;
+      ok = measureMove(target, timeout, seconds, epos);
+      if (!ok)
+        break;
+      result.settleTime += seconds / repeats;
+
+      // the accepted EPOS is always inside PTOL, the final error is read after the hold time
+      epicsThreadSleep(holdTime);
+      try
+      {
+        pC_->lock();
+        pC_->getParameter<XD_EPOS>(this->pC_, epos);
+        pC_->unlock();
+      }
+      catch (const std::exception &e)
+      {
+        pC_->unlock();
+        asynPrint(this->pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::tunePositionTolerance: %s\n", e.what());
+        ok = false;
+        break;
+      }
+      result.maxError = std::max(result.maxError, std::abs(epos - target));
+    }
+    if (!ok)
+    {
+      std::cout << ptol << ": move failed\n";
+      if (abortMeasure_)
+        break;
+      continue;
+    }
+
+    std::cout << ptol << ", " << result.settleTime << ", " << result.maxError << "\n";
+    if (result.maxError <= accuracy && result.settleTime < best.settleTime)
+    {
+      best = result;
+      found = true;
+    }
+  }
+
+  // leave the axis as found
+  double seconds;
+  int epos;
+  measureMove(origin, timeout, seconds, epos);
+  try
+  {
+    pC_->lock();
+    pC_->setParameter<XD_PTOL>(this->pC_, originalPtol);
+    pC_->unlock();
+  }
+  catch (const std::exception &e)
+  {
+    pC_->unlock();
+    asynPrint(this->pC_->pasynUserSelf, ASYN_TRACE_ERROR, "XDAxis::tunePositionTolerance: %s\n", e.what());
+  }
+  return found;
+}
@@ -2,12 +2,16 @@
 #define XERYON_XD_AXIS_H
 
 #include <array>
+#include <atomic>
 #include <string>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "asynMotorAxis.h"
 #include "XeryonAxis.h" // convenience class
+#include "XeryonMotionEstimator.h"
+#include "XeryonTuning.h"
 
 class XDController;
 
@@ -66,6 +70,7 @@ public:
   /**
    * @brief Stop the axis.
    * @details This method will force the driver output to zero. No controlled deceleration is performed.
+   * A step scan or PTOL tuning running on the axis is aborted, so no further target is sent.
    * @param[in] acceleration The desiered acceleration // disregarded in this driver for the moment
    */
   asynStatus stop(double acceleration);
@@ -99,14 +104,67 @@ public:
     return decodeReply(buf, "=");
   };
 
+  /**
+   * @brief Find the positioning tolerance with the shortest settle time that meets the accuracy.
+   * @details Runs test moves of step counts back and forth for each candidate PTOL.
+   * The settle time ends when the position is reached, the final error is read from EPOS after a hold time.
+   * PTOL and the position are restored afterwards. Blocks until all moves are done.
+   * @param[in] candidates PTOL values to test
+   * @param[in] accuracy largest acceptable final error in counts
+   * @param[in] step test move distance in counts
+   * @param[in] repeats test moves per candidate
+   * @param[out] best fastest candidate meeting the accuracy
+   * @return false if no candidate met the accuracy
+   */
+  bool tunePositionTolerance(const std::vector<int> &candidates, int accuracy, int step, int repeats, XeryonTuningResult &best);
+
+  /**
+   * @brief Stop trusting the index, the next home() runs the index search.
+   * @details The index is trusted again once it is found in this session.
+   */
+  void forgetIndex();
+
   // asynStatus status;
 
 private:
+  /**
+   * @brief Move to target and wait for position reached, querying STAT back to back.
+   *
+   * A set position reached bit only counts once EPOS is within PTOL of the target.
+   * Gives up as soon as abortMeasure_ is set; it is checked under the controller lock before DPOS is sent.
+   * @param[in] target target position
+   * @param[in] timeout give up after timeout s
+   * @param[out] seconds time from DPOS to position reached
+   * @param[out] epos encoder position when the position was reached
+   * @return false on abort, timeout or communication error
+   */
+  bool measureMove(int target, double timeout, double &seconds, int &epos);
+
+  /**
+   * @brief Compare the live index state with the homing cache and store changes.
+   * @details The first call after the cache was opened decides whether a cached index can be trusted:
+   * same controller serial number, same stage type, valid in the cache and valid in the live STAT.
+   * Afterwards an index is only trusted once it is found in this session, i.e. the encoder valid bit
+   * rises or an index search ends with it set; a lost index is never trusted.
+   */
+  void updateHomingCache();
+
   /**
    * @brief Pointer to the asynMotorController to which this axis belongs.
    */
   XDController *pC_;
 
+  XeryonMotionEstimator estimator_; /**< velocity and move statistics */
+
+  std::vector<int32_t> scanPositionList_; /**< position list of the step scan */
+  std::vector<int32_t> scanReadbackList_; /**< encoder position at every point of the last scan */
+  std::atomic<bool> abortMeasure_{false};  /**< set by stop() and abortScan(), ends measureMove() */
+
+  bool indexChecked_ = false; /**< live state compared with the homing cache */
+  bool indexTrusted_ = false; /**< index is valid and was found by INDX for this stage */
+  bool lastIndexValid_ = false; /**< encoder valid bit of the previous poll */
+  bool indexSearchSeen_ = false; /**< searching index bit seen, waiting for the search to end */
+
   friend class XDController;
 };
 
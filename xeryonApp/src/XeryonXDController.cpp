@@ -7,44 +7,116 @@
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
 
+#include <algorithm>
+#include <sstream>
+
 #include <epicsExport.h>
 #include "XeryonXDController.h"
 #include "XeryonXDAxis.h"
+#include "XeryonPollExecutor.h"
 
 static const char *driverName = "XeryonXDMotorDriver";
 
+/**
+ * @brief Transport of the protocol client through the asyn octet port of a controller.
+ * @details Goes through writeController/writeReadController, so tracing and replay see all traffic.
+ */
+class XDAsynTransport : public XeryonTransport
+{
+public:
+    explicit XDAsynTransport(XDController *pC) : pC_(pC){};
+
+    void write(const std::string &command)
+    {
+        if (pC_->writeController(command.c_str(), DEFAULT_CONTROLLER_TIMEOUT))
+        {
+            throw XeryonControllerException("Failed to set parameter " + command);
+        }
+    };
+
+    std::string writeRead(const std::string &command)
+    {
+        char reply[MAX_CONTROLLER_STRING_SIZE];
+        size_t len = 0;
+        if (pC_->writeReadController(command.c_str(), reply, sizeof(reply), &len, DEFAULT_CONTROLLER_TIMEOUT))
+        {
+            throw XeryonControllerException("Failed to get parameter " + command);
+        }
+        return std::string(reply, len);
+    };
+
+private:
+    XDController *pC_;
+};
+
 XDController::XDController(const char *portName, const char *XDPortName, int numAxes,
-                           double movingPollPeriod, double idlePollPeriod)
+                           double movingPollPeriod, double idlePollPeriod, const char *replayFile, const char *traceFile)
     : asynMotorController(portName, numAxes, NUM_XD_PARAMS,
                           0, 0,
                           ASYN_CANBLOCK | ASYN_MULTIDEVICE,
                           1,    // autoconnect
-                          0, 0) // Default priority and stack size
+                          0, 0), // Default priority and stack size
+      client_(std::make_shared<XDAsynTransport>(this))
 {
     asynStatus status;
     static const char *functionName = "XDController";
     asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "XDController::XDController: Creating controller\n");
 
-    // Create controller-specific parameters
-    createParam(XDstatString, asynParamInt32, &this->statrb_); // whole positioner status word
-    createParam(XDsspdString, asynParamInt32, &this->sspdrb_); // sspd readback
-    createParam(XDeposString, asynParamInt32, &this->eposrb_); // epos readback
-    createParam(XDdposString, asynParamInt32, &this->dposrb_); // dpos readback
-    // extra stage info
-    createParam(XDfreqString, asynParamInt32, &this->freqrb_);
+    // Create controller-specific parameters, one per command flagged in the command table
+    for (int cmd = 0; cmd < XD_NUM_COMMANDS; cmd++)
+    {
+        cmdParam_[cmd] = -1;
+        if (xdCommands[cmd].hasParam)
+            createParam(xdCommands[cmd].tag, asynParamInt32, &this->cmdParam_[cmd]);
+    }
+
+    // controller-wide snapshots, one element per axis
+    createParam(XDstatArrayString, asynParamInt32Array, &this->statArray_);
+    createParam(XDeposArrayString, asynParamInt32Array, &this->eposArray_);
+    createParam(XDdposArrayString, asynParamInt32Array, &this->dposArray_);
+    state_.resize(numAxes);
+
+    // estimates from the time stamped samples
+    createParam(XDveloString, asynParamFloat64, &this->velo_);
+    createParam(XDremainingString, asynParamInt32, &this->remaining_);
+    createParam(XDsettleString, asynParamFloat64, &this->settle_);
+    createParam(XDovershootString, asynParamInt32, &this->overshoot_);
+
+    // step scan engine
+    createParam(XDscanPositionsString, asynParamInt32Array, &this->scanPositions_);
+    createParam(XDscanDwellString, asynParamFloat64, &this->scanDwell_);
+    createParam(XDscanTimeoutString, asynParamFloat64, &this->scanTimeout_);
+    createParam(XDscanRunString, asynParamInt32, &this->scanRun_);
+    createParam(XDscanPointString, asynParamInt32, &this->scanPoint_);
+    createParam(XDscanReadbackString, asynParamInt32Array, &this->scanReadback_);
+    for (int axis = 0; axis < numAxes; axis++)
+    {
+        setDoubleParam(axis, scanTimeout_, 10.);
+    }
 
-    // stage commands
-    createParam(XDindxString, asynParamInt32, &this->indx_);
-    createParam(XDptolString, asynParamInt32, &this->ptol_);
-    createParam(XDpto2String, asynParamInt32, &this->pto2_);
+    // homing cache
+    createParam(XDforgetIndexString, asynParamInt32, &this->forgetIndex_);
 
-    // LED test
-    createParam(XDtestString, asynParamInt32, &this->test_);
+    // record from the first command on, so the trace can be replayed from construction
+    if (traceFile)
+        traceRecorder_.open(traceFile);
 
-    /* Connect to XD controller */
-    status = pasynOctetSyncIO->connect(XDPortName, 0, &pasynUserController_, NULL);
-    pasynOctetSyncIO->setInputEos(pasynUserController_, "\n", 1);
-    pasynOctetSyncIO->setOutputEos(pasynUserController_, "\n", 1);
+    if (replayFile)
+    {
+        /* Replay a recorded session instead of talking to a controller */
+        tracePlayer_.load(replayFile);
+        replay_ = true;
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: replaying %s, %zu entries\n",
+                  replayFile, tracePlayer_.getSize());
+        status = asynSuccess;
+    }
+    else
+    {
+        /* Connect to XD controller */
+        status = pasynOctetSyncIO->connect(XDPortName, 0, &pasynUserController_, NULL);
+        pasynOctetSyncIO->setInputEos(pasynUserController_, "\n", 1);
+        pasynOctetSyncIO->setOutputEos(pasynUserController_, "\n", 1);
+    }
 
     asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "XDController::XDController: Connecting to controller\n");
     if (status)
@@ -56,17 +128,47 @@ XDController::XDController(const char *portName, const char *XDPortName, int num
 
     // Create the axis objects
     asynPrint(this->pasynUserSelf, ASYN_TRACEIO_DRIVER, "XDController::XDController: Creating axes\n");
-    for (size_t axis = 0; axis < numAxes; axis++)
+    controllerAxes.reserve(numAxes);
+    for (int axis = 0; axis < numAxes; axis++)
     {
-        controllerAxes[axis] = std::make_shared<XDAxis>(this, axis);
+        controllerAxes.push_back(std::make_shared<XDAxis>(this, axis));
     }
 
-    int reply;
-    getParameter(this, "SOFT", reply);
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: software verions: %d\n", reply);
-    getParameter(this, "SRNO", reply);
-    asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: serial number: %d\n", reply);
-    startPoller(movingPollPeriod, idlePollPeriod, 2);
+    try
+    {
+        int reply;
+        getParameter<XD_SOFT>(this, reply);
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: software verions: %d\n", reply);
+        getParameter<XD_SRNO>(this, reply);
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: serial number: %d\n", reply);
+        serialNumber_ = reply;
+    }
+    catch (const std::exception &e)
+    {
+        asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "XDController::XDController: %s\n", e.what());
+    }
+
+    XDPollExecutor &executor = XDPollExecutor::getInstance();
+    if (executor.isEnabled())
+    {
+        sharedPoller_ = true;
+        movingPollPeriod_ = movingPollPeriod;
+        idlePollPeriod_ = idlePollPeriod;
+        forcedFastPolls_ = 2;
+        executor.add(this);
+    }
+    else
+    {
+        startPoller(movingPollPeriod, idlePollPeriod, 2);
+    }
+}
+
+XDController::~XDController()
+{
+    // a std::thread still joinable at destruction terminates the IOC
+    abortScan();
+    if (scanThread_.joinable())
+        scanThread_.join();
 }
 
 /**
@@ -77,12 +179,14 @@ XDController::XDController(const char *portName, const char *XDPortName, int num
  * @param[in] numAxes The number of axes that this controller supports
  * @param[in] movingPollPeriod The time in ms between polls when any axis is moving
  * @param[in] idlePollPeriod The time in ms between polls when no axis is moving
+ * @param[in] traceFile Trace file recording all traffic from construction on, empty for none
  */
-int XDCreateController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod)
+int XDCreateController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod,
+                       const std::string &traceFile)
 {
     try
     {
-        ControllerHolder::getInstance().addController(portName, XDPortName, numAxes, movingPollPeriod, idlePollPeriod);
+        ControllerHolder::getInstance().addController(portName, XDPortName, numAxes, movingPollPeriod, idlePollPeriod, "", traceFile);
     }
     catch (const std::runtime_error &e)
     {
@@ -93,6 +197,202 @@ int XDCreateController(const std::string &portName, const std::string &XDPortNam
     return (asynSuccess);
 }
 
+/**
+ * @brief Creates a XDController object which replays a recorded trace instead of talking to a controller.
+ * @details Configuration command, called directly or from iocsh
+ * @param[in] portName The name of the asyn port that will be created for this driver
+ * @param[in] traceFile The trace file recorded with XDCreateController or XDTraceStart
+ * @param[in] numAxes The number of axes that this controller supports
+ * @param[in] movingPollPeriod The time in ms between polls when any axis is moving
+ * @param[in] idlePollPeriod The time in ms between polls when no axis is moving
+ */
+int XDCreateReplayController(const std::string &portName, const std::string &traceFile, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod)
+{
+    try
+    {
+        ControllerHolder::getInstance().addController(portName, "", numAxes, movingPollPeriod, idlePollPeriod, traceFile);
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cout << "Driver configuration problem: " << e.what() << std::endl
+                  << "Aborting initialization..." << std::endl;
+        epicsExit(-1);
+    }
+    return (asynSuccess);
+}
+
+/**
+ * @brief Starts recording the traffic of a controller.
+ * @details Configuration command, called directly or from iocsh
+ * @param[in] portName The name of the asyn port of the controller
+ * @param[in] traceFile The trace file to write, overwritten if it exists
+ */
+int XDTraceStart(const std::string &portName, const std::string &traceFile)
+{
+    try
+    {
+        ControllerHolder::getInstance().getController(portName)->startTrace(traceFile);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Failed to start trace: " << e.what() << std::endl;
+        return (asynError);
+    }
+    return (asynSuccess);
+}
+
+/**
+ * @brief Stops recording the traffic of a controller.
+ * @details Configuration command, called directly or from iocsh
+ * @param[in] portName The name of the asyn port of the controller
+ */
+int XDTraceStop(const std::string &portName)
+{
+    try
+    {
+        ControllerHolder::getInstance().getController(portName)->stopTrace();
+    }
+    catch (const std::out_of_range &e)
+    {
+        std::cout << "Controller with provided name does not exist. "
+                  << "Exception: " << e.what() << std::endl;
+        return (asynError);
+    }
+    return (asynSuccess);
+}
+
+/**
+ * @brief Keeps the homing state of a controller in a file, to skip homing after a restart if the index is still valid.
+ * @details Configuration command, called directly or from iocsh after XDconfigureAxis
+ * @param[in] portName The name of the asyn port of the controller
+ * @param[in] fileName The cache file, created if it does not exist
+ */
+int XDHomingCache(const std::string &portName, const std::string &fileName)
+{
+    try
+    {
+        ControllerHolder::getInstance().getController(portName)->openHomingCache(fileName);
+    }
+    catch (const std::out_of_range &e)
+    {
+        std::cout << "Controller with provided name does not exist. "
+                  << "Exception: " << e.what() << std::endl;
+        return (asynError);
+    }
+    return (asynSuccess);
+}
+
+/**
+ * @brief Key of a stage type in the tuning file.
+ */
+static std::string tuningKey(XDAxis *pAxis)
+{
+    return pAxis->getStageType().empty() ? "-" : pAxis->getStageType();
+}
+
+/**
+ * @brief Tunes the positioning tolerance of an axis for the shortest settle time.
+ * @details Called from iocsh after iocInit. The axis is moved, the motor record follows the moves through the poller.
+ * @param[in] portName The name of the asyn port of the controller
+ * @param[in] axisNo The axis to tune
+ * @param[in] candidates Comma separated list of PTOL values to test
+ * @param[in] accuracy Largest acceptable final error in counts
+ * @param[in] step Test move distance in counts
+ * @param[in] repeats Test moves per candidate
+ * @param[in] fileName Tuning file, the result is stored for the stage type of the axis
+ * @param[in] apply Set the best PTOL on the axis if not 0
+ */
+int XDTunePtol(const std::string &portName, const int axisNo, const std::string &candidates, const int accuracy,
+               const int step, const int repeats, const std::string &fileName, const int apply)
+{
+    std::vector<int> values;
+    std::stringstream list(candidates);
+    std::string value;
+    while (std::getline(list, value, ','))
+    {
+        values.push_back(atoi(value.c_str()));
+    }
+
+    try
+    {
+        XDController *device = ControllerHolder::getInstance().getController(portName).get();
+        std::shared_ptr<XDAxis> pAxis = device->getAxisPointer(axisNo);
+        XeryonTuningResult best;
+        if (!pAxis->tunePositionTolerance(values, accuracy, step, repeats > 0 ? repeats : 1, best))
+        {
+            std::cout << "No PTOL candidate meets the accuracy of " << accuracy << " counts" << std::endl;
+            return (asynError);
+        }
+        std::cout << "Best PTOL=" << best.ptol << ", settle time " << best.settleTime << " s, max error " << best.maxError << std::endl;
+
+        XeryonTuningStore store;
+        store.load(fileName);
+        store.set(tuningKey(pAxis.get()), best);
+        if (apply)
+            device->setPositionTolerance(axisNo, best.ptol);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Failed to tune PTOL: " << e.what() << std::endl;
+        return (asynError);
+    }
+    return (asynSuccess);
+}
+
+/**
+ * @brief Sets the positioning tolerance of an axis from the tuning file.
+ * @param[in] portName The name of the asyn port of the controller
+ * @param[in] axisNo The axis to configure
+ * @param[in] fileName Tuning file written by XDTunePtol
+ */
+int XDApplyTuning(const std::string &portName, const int axisNo, const std::string &fileName)
+{
+    try
+    {
+        XDController *device = ControllerHolder::getInstance().getController(portName).get();
+        std::shared_ptr<XDAxis> pAxis = device->getAxisPointer(axisNo);
+        XeryonTuningStore store;
+        XeryonTuningResult result;
+        store.load(fileName);
+        if (!store.get(tuningKey(pAxis.get()), result))
+        {
+            std::cout << "No tuning for stage type " << tuningKey(pAxis.get()) << " in " << fileName << std::endl;
+            return (asynError);
+        }
+        device->setPositionTolerance(axisNo, result.ptol);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "Failed to apply tuning: " << e.what() << std::endl;
+        return (asynError);
+    }
+    return (asynSuccess);
+}
+
+static void XDSharedPollerExit(void *)
+{
+    XDPollExecutor::getInstance().stop();
+}
+
+/**
+ * @brief Poll all controllers created afterwards from a shared pool of threads.
+ * @details Configuration command, called directly or from iocsh before XDCreateController
+ * @param[in] numThreads The number of worker threads
+ */
+int XDSharedPoller(const int numThreads)
+{
+    if (numThreads < 1)
+    {
+        std::cout << "XDSharedPoller: at least one thread is required" << std::endl;
+        return (asynError);
+    }
+    XDPollExecutor &executor = XDPollExecutor::getInstance();
+    if (!executor.isEnabled())
+        epicsAtExit(XDSharedPollerExit, NULL);
+    executor.start(numThreads);
+    return (asynSuccess);
+}
+
 /**
  * @brief Configures an axis object in a respective controller.
  * @details Configuration command, called directly or from iocsh
@@ -122,11 +422,61 @@ void XDController::report(FILE *fp, int level)
 {
     fprintf(fp, "XD motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n",
             this->portName, numAxes_, movingPollPeriod_, idlePollPeriod_);
+    fprintf(fp, "  axes in position=%zu of %zu\n", state_.count(1u << positionReachedBit), state_.size());
+    fprintf(fp, "  queries=%zu, mean latency=%f ms, max latency=%f ms\n",
+            numQueries_, numQueries_ ? 1e3 * sumLatency_ / numQueries_ : 0., 1e3 * maxLatency_);
+    if (traceRecorder_.isOpen())
+        fprintf(fp, "  recording trace\n");
+    if (scanRunning_)
+        fprintf(fp, "  step scan running on axis %d\n", scanAxis_);
+    if (replay_)
+        fprintf(fp, "  replaying trace, entry %zu of %zu, mismatched commands=%zu\n",
+                tracePlayer_.getPosition(), tracePlayer_.getSize(), tracePlayer_.getMismatches());
+
+    if (sharedPoller_ && level > 0)
+        XDPollExecutor::getInstance().report(fp);
 
     // Call the base class method
     asynMotorController::report(fp, level);
 }
 
+asynStatus XDController::wakeupPoller()
+{
+    if (!sharedPoller_)
+        return asynMotorController::wakeupPoller();
+
+    XDPollExecutor::getInstance().wakeup(this, forcedFastPolls_);
+    return asynSuccess;
+}
+
+bool XDController::pollAll(double &movingPollPeriod, double &idlePollPeriod)
+{
+    bool anyMoving = false;
+    bool moving;
+
+    lock();
+    // set with setMovingPollPeriod/setIdlePollPeriod at run time
+    movingPollPeriod = movingPollPeriod_;
+    idlePollPeriod = idlePollPeriod_;
+    if (shuttingDown_)
+    {
+        unlock();
+        return false;
+    }
+    poll();
+    for (int axis = 0; axis < numAxes_; axis++)
+    {
+        XDAxis *pAxis = getAxis(axis);
+        if (!pAxis)
+            continue;
+        pAxis->poll(&moving);
+        if (moving)
+            anyMoving = true;
+    }
+    unlock();
+    return anyMoving;
+}
+
 XDAxis *XDController::getAxis(asynUser *pasynUser)
 {
     return static_cast<XDAxis *>(asynMotorController::getAxis(pasynUser));
@@ -148,26 +498,34 @@ asynStatus XDController::writeInt32(asynUser *pasynUser, epicsInt32 value)
     //  * status at the end, but that's OK */
     status = setIntegerParam(pAxis->axisNo_, function, value);
 
-    if (function == indx_)
+    /* commands with a writable parameter (INDX, PTOL, PTO2, TEST) are passed to the controller */
+    const int *cmd = std::find(cmdParam_, cmdParam_ + XD_NUM_COMMANDS, function);
+    if (function == forgetIndex_)
     {
-        /* move to index (homing) */
-        sprintf(pAxis->pC_->outString_, "INDX=%d", value);
-        status = pAxis->pC_->writeController();
+        if (value)
+            pAxis->forgetIndex();
+        setIntegerParam(pAxis->axisNo_, forgetIndex_, 0);
     }
-    else if (function == ptol_)
+    else if (function == scanRun_)
     {
-        sprintf(pAxis->pC_->outString_, "PTOL=%d", value);
-        status = pAxis->pC_->writeController();
+        if (!value)
+            abortScan();
+        else if (!startScan(pAxis->axisNo_))
+            status = asynError;
+        // busy until the scan thread is done
+        setIntegerParam(pAxis->axisNo_, scanRun_, scanRunning_);
     }
-    else if (function == pto2_)
+    else if (cmd != cmdParam_ + XD_NUM_COMMANDS && xdCommands[cmd - cmdParam_].asynWrite)
     {
-        sprintf(pAxis->pC_->outString_, "PTO2=%d", value);
-        status = pAxis->pC_->writeController();
-    }
-    else if (function == test_)
-    {
-        sprintf(pAxis->pC_->outString_, "TEST=%d", value);
-        status = pAxis->pC_->writeController();
+        try
+        {
+            setParameter(this, XDCmd(cmd - cmdParam_), value);
+        }
+        catch (const std::exception &e)
+        {
+            asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:%s: %s\n", driverName, functionName, e.what());
+            status = asynError;
+        }
     }
     else
     {
@@ -188,41 +546,250 @@ asynStatus XDController::writeInt32(asynUser *pasynUser, epicsInt32 value)
     return status;
 }
 
-void XDController::setParameter(XDController *device, const std::string &cmd, const int &payload)
+asynStatus XDController::readInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements, size_t *nIn)
 {
-    sprintf(device->outString_, "%s=%d", cmd.c_str(), payload);
-    asynStatus status = device->writeController();
-    if (status)
+    int function = pasynUser->reason;
+    const std::vector<int32_t> *snapshot;
+    XDAxis *pAxis = getAxis(pasynUser);
+
+    if (pAxis && function == scanPositions_)
+        snapshot = &pAxis->scanPositionList_;
+    else if (pAxis && function == scanReadback_)
+        snapshot = &pAxis->scanReadbackList_;
+    else if (function == statArray_)
+        snapshot = &state_.status;
+    else if (function == eposArray_)
+        snapshot = &state_.epos;
+    else if (function == dposArray_)
+        snapshot = &state_.dpos;
+    else
+        return asynMotorController::readInt32Array(pasynUser, value, nElements, nIn);
+
+    *nIn = std::min(nElements, snapshot->size());
+    std::copy(snapshot->begin(), snapshot->begin() + *nIn, value);
+    return asynSuccess;
+}
+
+asynStatus XDController::writeInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements)
+{
+    int function = pasynUser->reason;
+    XDAxis *pAxis = getAxis(pasynUser);
+
+    if (!pAxis || function != scanPositions_)
+        return asynMotorController::writeInt32Array(pasynUser, value, nElements);
+
+    if (scanRunning_ && scanAxis_ == pAxis->axisNo_)
     {
-        throw XeryonControllerException("Failed to set parameter" + std::string(device->outString_));
+        asynPrint(pasynUser, ASYN_TRACE_ERROR, "%s:writeInt32Array: scan running, positions not changed\n", driverName);
+        return asynError;
     }
-};
+    pAxis->scanPositionList_.assign(value, value + nElements);
+    return asynSuccess;
+}
 
-void XDController::getParameter(XDController *device, const std::string &cmd, int &reply)
+bool XDController::startScan(int axisNo)
 {
-    sprintf(device->outString_, "%s=?", cmd.c_str());
-    asynStatus status = device->writeReadController();
-    if (status)
+    XDAxis *pAxis = getAxis(axisNo);
+    if (scanRunning_ || !pAxis || pAxis->scanPositionList_.empty())
+        return false;
+
+    // soft limits of the motor record (DHLM/DLLM) in counts, equal limits disable the check
+    double high = 0., low = 0.;
+    getDoubleParam(axisNo, motorHighLimit_, &high);
+    getDoubleParam(axisNo, motorLowLimit_, &low);
+    if (high != low)
     {
-        throw XeryonControllerException("Failed to get parameter" + std::string(device->outString_));
+        for (size_t point = 0; point < pAxis->scanPositionList_.size(); point++)
+        {
+            int32_t position = pAxis->scanPositionList_[point];
+            if (position > high || position < low)
+            {
+                asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:startScan: point %zu (%d) outside the soft limits [%g, %g]\n",
+                          driverName, point, position, low, high);
+                return false;
+            }
+        }
     }
-    std::string buf = device->inString_;
+
+    // the previous scan thread has already left runScan()
+    if (scanThread_.joinable())
+        scanThread_.join();
+
+    pAxis->scanReadbackList_.assign(pAxis->scanPositionList_.size(), 0);
+    scanAxis_ = axisNo;
+    scanAbort_ = false;
+    pAxis->abortMeasure_ = false;
+    scanRunning_ = true;
+    setIntegerParam(axisNo, scanRun_, 1);
+    scanThread_ = std::thread(&XDController::runScan, this);
+    return true;
+}
+
+void XDController::abortScan()
+{
+    scanAbort_ = true;
+    XDAxis *pAxis = getAxis(scanAxis_);
+    if (pAxis)
+        pAxis->abortMeasure_ = true;
+}
+
+void XDController::runScan()
+{
+    XDAxis *pAxis = getAxis(scanAxis_);
+    double timeout = 0.;
+    double dwell = 0.;
+    size_t point = 0;
+
+    lock();
+    getDoubleParam(scanAxis_, scanTimeout_, &timeout);
+    getDoubleParam(scanAxis_, scanDwell_, &dwell);
+    unlock();
+
+    for (; point < pAxis->scanPositionList_.size() && !scanAbort_; point++)
+    {
+        double seconds;
+        int epos;
+        if (!pAxis->measureMove(pAxis->scanPositionList_[point], timeout, seconds, epos))
+        {
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR, "%s:runScan: point %zu %s, scan aborted\n", driverName, point,
+                      scanAbort_ ? "abandoned" : "not reached");
+            break;
+        }
+
+        // trigger
+        lock();
+        pAxis->scanReadbackList_[point] = epos;
+        setIntegerParam(scanAxis_, scanPoint_, point);
+        callParamCallbacks(scanAxis_);
+        if (scanCallback_)
+            scanCallback_(scanAxis_, point, epos);
+        unlock();
+
+        if (dwell > 0.)
+            epicsThreadSleep(dwell);
+    }
+
+    lock();
+    doCallbacksInt32Array(pAxis->scanReadbackList_.data(), point, scanReadback_, scanAxis_);
+    setIntegerParam(scanAxis_, scanRun_, 0);
+    callParamCallbacks(scanAxis_);
+    scanRunning_ = false;
+    unlock();
+}
+
+void XDController::publishSnapshot()
+{
+    XeryonStateBlock::Changes changes = state_.update();
+
+    updateTimeStamp();
+    if (changes.status || !statePublished_)
+        doCallbacksInt32Array(state_.status.data(), state_.size(), statArray_, 0);
+    if (changes.positions || !statePublished_)
+    {
+        doCallbacksInt32Array(state_.epos.data(), state_.size(), eposArray_, 0);
+        doCallbacksInt32Array(state_.dpos.data(), state_.size(), dposArray_, 0);
+    }
+    statePublished_ = true;
+}
+
+asynStatus XDController::writeController(const char *output, double timeout)
+{
+    asynStatus status;
+
+    if (replay_)
+        status = tracePlayer_.write(output) ? asynSuccess : asynError;
+    else
+        status = asynMotorController::writeController(output, timeout);
+
+    traceRecorder_.record(XeryonTraceEntry::Write, output);
+    return status;
+}
+
+asynStatus XDController::writeReadController(const char *output, char *response, size_t maxResponseLen, size_t *responseLen, double timeout)
+{
+    asynStatus status;
+    auto start = std::chrono::steady_clock::now();
+
+    traceRecorder_.record(XeryonTraceEntry::Query, output);
+    if (replay_)
+    {
+        std::string reply;
+        status = tracePlayer_.writeRead(output, reply) ? asynSuccess : asynError;
+        *responseLen = reply.copy(response, maxResponseLen - 1);
+        response[*responseLen] = '\0';
+    }
+    else
+    {
+        status = asynMotorController::writeReadController(output, response, maxResponseLen, responseLen, timeout);
+    }
+    traceRecorder_.record(XeryonTraceEntry::Reply, status ? "" : response);
+
+    double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    numQueries_++;
+    sumLatency_ += latency;
+    maxLatency_ = std::max(maxLatency_, latency);
+    return status;
+}
+
+void XDController::openHomingCache(const std::string &fileName)
+{
+    lock();
+    homingCache_.open(fileName);
+    // compare with the live state on the next poll
+    for (int axis = 0; axis < numAxes_; axis++)
+    {
+        controllerAxes[axis]->indexChecked_ = false;
+    }
+    unlock();
+}
+
+void XDController::setPositionTolerance(int axisNo, int ptol)
+{
+    lock();
     try
     {
-        reply = atoi(buf.substr(buf.find("=") + 1).c_str());
+        setParameter<XD_PTOL>(this, ptol);
     }
-    catch (const std::exception &e)
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+    setIntegerParam(axisNo, cmdParam_[XD_PTOL], ptol);
+    callParamCallbacks(axisNo);
+    unlock();
+}
+
+void XDController::startTrace(const std::string &fileName)
+{
+    lock();
+    try
     {
-        std::cerr << "failed to decode controller reply (" << buf << "). Exception: " << e.what() << '\n';
+        traceRecorder_.open(fileName);
     }
+    catch (...)
+    {
+        unlock();
+        throw;
+    }
+    unlock();
+}
 
-};
+void XDController::stopTrace()
+{
+    lock();
+    traceRecorder_.close();
+    unlock();
+}
 
-void ControllerHolder::addController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod)
+void ControllerHolder::addController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod,
+                                     const std::string &replayFile, const std::string &traceFile)
 {
     if (controllerMap.find(portName) == controllerMap.end())
     {
-        std::pair<std::string, std::shared_ptr<XDController>> controller(portName, std::shared_ptr<XDController>(new XDController(portName.c_str(), XDPortName.c_str(), numAxes, movingPollPeriod / 1000., idlePollPeriod / 1000.)));
+        std::pair<std::string, std::shared_ptr<XDController>> controller(portName, std::shared_ptr<XDController>(new XDController(portName.c_str(), XDPortName.c_str(), numAxes, movingPollPeriod / 1000., idlePollPeriod / 1000.,
+                                                                                                                                  replayFile.empty() ? NULL : replayFile.c_str(),
+                                                                                                                                  traceFile.empty() ? NULL : traceFile.c_str())));
         controllerMap.insert(controller);
     }
     else
@@ -243,15 +810,17 @@ static const iocshArg XDCreateControllerArg1 = {"XD port name", iocshArgString};
 static const iocshArg XDCreateControllerArg2 = {"Number of axes", iocshArgInt};
 static const iocshArg XDCreateControllerArg3 = {"Moving poll period (ms)", iocshArgInt};
 static const iocshArg XDCreateControllerArg4 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg XDCreateControllerArg5 = {"Trace file (optional)", iocshArgString};
 static const iocshArg *const XDCreateControllerArgs[] = {&XDCreateControllerArg0,
                                                          &XDCreateControllerArg1,
                                                          &XDCreateControllerArg2,
                                                          &XDCreateControllerArg3,
-                                                         &XDCreateControllerArg4};
-static const iocshFuncDef XDCreateControllerDef = {"XDCreateController", 5, XDCreateControllerArgs};
+                                                         &XDCreateControllerArg4,
+                                                         &XDCreateControllerArg5};
+static const iocshFuncDef XDCreateControllerDef = {"XDCreateController", 6, XDCreateControllerArgs};
 static void XDCreateContollerCallFunc(const iocshArgBuf *args)
 {
-    XDCreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival);
+    XDCreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival, args[5].sval ? args[5].sval : "");
 }
 
 static const iocshArg XDconfigureAxisArg0 = {"Port name", iocshArgString};
@@ -265,10 +834,104 @@ static void XDconfigureAxisCallFunc(const iocshArgBuf *args)
 {
     XDconfigureAxis(args[0].sval, args[1].ival, args[2].sval);
 }
+
+static const iocshArg XDCreateReplayControllerArg0 = {"Port name", iocshArgString};
+static const iocshArg XDCreateReplayControllerArg1 = {"Trace file", iocshArgString};
+static const iocshArg XDCreateReplayControllerArg2 = {"Number of axes", iocshArgInt};
+static const iocshArg XDCreateReplayControllerArg3 = {"Moving poll period (ms)", iocshArgInt};
+static const iocshArg XDCreateReplayControllerArg4 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg *const XDCreateReplayControllerArgs[] = {&XDCreateReplayControllerArg0,
+                                                               &XDCreateReplayControllerArg1,
+                                                               &XDCreateReplayControllerArg2,
+                                                               &XDCreateReplayControllerArg3,
+                                                               &XDCreateReplayControllerArg4};
+static const iocshFuncDef XDCreateReplayControllerDef = {"XDCreateReplayController", 5, XDCreateReplayControllerArgs};
+static void XDCreateReplayControllerCallFunc(const iocshArgBuf *args)
+{
+    XDCreateReplayController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival);
+}
+
+static const iocshArg XDTraceStartArg0 = {"Port name", iocshArgString};
+static const iocshArg XDTraceStartArg1 = {"Trace file", iocshArgString};
+static const iocshArg *const XDTraceStartArgs[] = {&XDTraceStartArg0,
+                                                   &XDTraceStartArg1};
+static const iocshFuncDef XDTraceStartDef = {"XDTraceStart", 2, XDTraceStartArgs};
+static void XDTraceStartCallFunc(const iocshArgBuf *args)
+{
+    XDTraceStart(args[0].sval, args[1].sval);
+}
+
+static const iocshArg XDTraceStopArg0 = {"Port name", iocshArgString};
+static const iocshArg *const XDTraceStopArgs[] = {&XDTraceStopArg0};
+static const iocshFuncDef XDTraceStopDef = {"XDTraceStop", 1, XDTraceStopArgs};
+static void XDTraceStopCallFunc(const iocshArgBuf *args)
+{
+    XDTraceStop(args[0].sval);
+}
+
+static const iocshArg XDHomingCacheArg0 = {"Port name", iocshArgString};
+static const iocshArg XDHomingCacheArg1 = {"Cache file", iocshArgString};
+static const iocshArg *const XDHomingCacheArgs[] = {&XDHomingCacheArg0,
+                                                    &XDHomingCacheArg1};
+static const iocshFuncDef XDHomingCacheDef = {"XDHomingCache", 2, XDHomingCacheArgs};
+static void XDHomingCacheCallFunc(const iocshArgBuf *args)
+{
+    XDHomingCache(args[0].sval, args[1].sval);
+}
+
+static const iocshArg XDTunePtolArg0 = {"Port name", iocshArgString};
+static const iocshArg XDTunePtolArg1 = {"Axis Number", iocshArgInt};
+static const iocshArg XDTunePtolArg2 = {"PTOL candidates (comma separated)", iocshArgString};
+static const iocshArg XDTunePtolArg3 = {"Accuracy (counts)", iocshArgInt};
+static const iocshArg XDTunePtolArg4 = {"Step (counts)", iocshArgInt};
+static const iocshArg XDTunePtolArg5 = {"Moves per candidate", iocshArgInt};
+static const iocshArg XDTunePtolArg6 = {"Tuning file", iocshArgString};
+static const iocshArg XDTunePtolArg7 = {"Apply", iocshArgInt};
+static const iocshArg *const XDTunePtolArgs[] = {&XDTunePtolArg0,
+                                                 &XDTunePtolArg1,
+                                                 &XDTunePtolArg2,
+                                                 &XDTunePtolArg3,
+                                                 &XDTunePtolArg4,
+                                                 &XDTunePtolArg5,
+                                                 &XDTunePtolArg6,
+                                                 &XDTunePtolArg7};
+static const iocshFuncDef XDTunePtolDef = {"XDTunePtol", 8, XDTunePtolArgs};
+static void XDTunePtolCallFunc(const iocshArgBuf *args)
+{
+    XDTunePtol(args[0].sval, args[1].ival, args[2].sval, args[3].ival, args[4].ival, args[5].ival, args[6].sval, args[7].ival);
+}
+
+static const iocshArg XDApplyTuningArg0 = {"Port name", iocshArgString};
+static const iocshArg XDApplyTuningArg1 = {"Axis Number", iocshArgInt};
+static const iocshArg XDApplyTuningArg2 = {"Tuning file", iocshArgString};
+static const iocshArg *const XDApplyTuningArgs[] = {&XDApplyTuningArg0,
+                                                    &XDApplyTuningArg1,
+                                                    &XDApplyTuningArg2};
+static const iocshFuncDef XDApplyTuningDef = {"XDApplyTuning", 3, XDApplyTuningArgs};
+static void XDApplyTuningCallFunc(const iocshArgBuf *args)
+{
+    XDApplyTuning(args[0].sval, args[1].ival, args[2].sval);
+}
+
+static const iocshArg XDSharedPollerArg0 = {"Number of threads", iocshArgInt};
+static const iocshArg *const XDSharedPollerArgs[] = {&XDSharedPollerArg0};
+static const iocshFuncDef XDSharedPollerDef = {"XDSharedPoller", 1, XDSharedPollerArgs};
+static void XDSharedPollerCallFunc(const iocshArgBuf *args)
+{
+    XDSharedPoller(args[0].ival);
+}
+
 static void XDMotorRegister(void)
 {
     iocshRegister(&XDCreateControllerDef, XDCreateContollerCallFunc);
     iocshRegister(&XDconfigureAxisDef, XDconfigureAxisCallFunc);
+    iocshRegister(&XDCreateReplayControllerDef, XDCreateReplayControllerCallFunc);
+    iocshRegister(&XDTraceStartDef, XDTraceStartCallFunc);
+    iocshRegister(&XDTraceStopDef, XDTraceStopCallFunc);
+    iocshRegister(&XDSharedPollerDef, XDSharedPollerCallFunc);
+    iocshRegister(&XDHomingCacheDef, XDHomingCacheCallFunc);
+    iocshRegister(&XDTunePtolDef, XDTunePtolCallFunc);
+    iocshRegister(&XDApplyTuningDef, XDApplyTuningCallFunc);
 }
 
 extern "C"
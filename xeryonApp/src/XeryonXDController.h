@@ -4,22 +4,34 @@
 #include "asynMotorController.h"
 #include "XeryonXDAxis.h"
 #include "XeryonException.h"
+#include "XeryonCommands.h"
+#include "XeryonClient.h"
+#include "XeryonTrace.h"
+#include "XeryonHomingCache.h"
+#include "XeryonStateBlock.h"
 
-#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
 
-#define XDstatString "STAT"
-#define XDsspdString "SSPD"
-#define XDeposString "EPOS"
-#define XDdposString "DPOS"
+#define XDstatArrayString "STAT_ARRAY"
+#define XDeposArrayString "EPOS_ARRAY"
+#define XDdposArrayString "DPOS_ARRAY"
 
-#define XDindxString "INDX"
+#define XDveloString "EST_VELO"
+#define XDremainingString "EST_REMAINING"
+#define XDsettleString "EST_SETTLE"
+#define XDovershootString "EST_OVERSHOOT"
 
-#define XDptolString "PTOL"
-#define XDpto2String "PTO2"
+#define XDscanPositionsString "SCAN_POSITIONS"
+#define XDscanDwellString "SCAN_DWELL"
+#define XDscanTimeoutString "SCAN_TIMEOUT"
+#define XDscanRunString "SCAN_RUN"
+#define XDscanPointString "SCAN_POINT"
+#define XDscanReadbackString "SCAN_READBACK"
 
-#define XDfreqString "FREQ"
-
-#define XDtestString "TEST"
+#define XDforgetIndexString "FORGET_INDEX"
 
 /**
  * @class Exception class used for exceptions related to MicroEpsilon controller.
@@ -39,8 +51,16 @@ public:
      * \param[in] numAxes              The number of axes that this controller supports
      * \param[in] movingPollPeriod     The time between polls when any axis is moving
      * \param[in] idlePollPeriod       The time between polls when no axis is moving
+     * \param[in] replayFile           Trace file to replay instead of connecting to XDPortName, NULL for normal operation
+     * \param[in] traceFile            Trace file recording all traffic from construction on, NULL for none
      */
-    XDController(const char *portName, const char *XDPortName, int numAxes, double movingPollPeriod, double idlePollPeriod);
+    XDController(const char *portName, const char *XDPortName, int numAxes, double movingPollPeriod, double idlePollPeriod,
+                 const char *replayFile = NULL, const char *traceFile = NULL);
+
+    /**
+     * @brief Abort a running step scan and wait for its thread.
+     */
+    ~XDController();
 
     /* These are the methods that we override from asynMotorDriver */
 
@@ -72,6 +92,40 @@ public:
      */
     void report(FILE *fp, int level);
 
+    /**
+     * @brief Wake up the poller, either the own poller thread or the shared poll executor.
+     */
+    asynStatus wakeupPoller();
+
+    /**
+     * @brief Poll the controller and all axes once.
+     * @details Body of the asynMotorController poller loop, used by the shared poll executor.
+     * Nothing is polled once the controller is shutting down.
+     * @param[out] movingPollPeriod current time in s between polls when any axis is moving
+     * @param[out] idlePollPeriod current time in s between polls when no axis is moving
+     * @return true if any axis is moving
+     */
+    bool pollAll(double &movingPollPeriod, double &idlePollPeriod);
+
+    /**
+     * @brief Called when asyn clients call pasynInt32Array->read().
+     * @details Returns the controller-wide snapshot of status words, encoder positions or target positions.
+     * @param[in] pasynUser asynUser structure that encodes the reason and address.
+     * @param[out] value Array to receive the snapshot.
+     * @param[in] nElements Number of elements available in value.
+     * @param[out] nIn Number of elements actually returned.
+     */
+    asynStatus readInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements, size_t *nIn);
+
+    /**
+     * @brief Called when asyn clients call pasynInt32Array->write().
+     * @details Sets the position list of the step scan engine for the axis encoded in pasynUser.
+     * @param[in] pasynUser asynUser structure that encodes the reason and address.
+     * @param[in] value Array of positions.
+     * @param[in] nElements Number of positions.
+     */
+    asynStatus writeInt32Array(asynUser *pasynUser, epicsInt32 *value, size_t nElements);
+
     /**
      * @brief Returns a pointer to an XDMotorAxis object.
      * @details Returns NULL if the axis number encoded in pasynUser is invalid.
@@ -86,21 +140,137 @@ public:
      */
     XDAxis *getAxis(int axisNo);
 
+    /**
+     * @brief Write a command to the controller, or consume it from the replayed trace.
+     * @details Records the command if a trace is running.
+     */
+    asynStatus writeController(const char *output, double timeout);
+
+    /**
+     * @brief Write a command and read the reply, or take the reply from the replayed trace.
+     * @details Records command and reply if a trace is running and accumulates the link latency statistics.
+     */
+    asynStatus writeReadController(const char *output, char *response, size_t maxResponseLen, size_t *responseLen, double timeout);
+
+    using asynMotorController::writeController;
+    using asynMotorController::writeReadController;
+
+    /**
+     * @brief Start recording all controller traffic.
+     * @param[in] fileName path of the trace file
+     */
+    void startTrace(const std::string &fileName);
+
+    /**
+     * @brief Stop recording controller traffic.
+     */
+    void stopTrace();
+
+    /**
+     * @brief Keep the homing state of all axes in a file.
+     * @param[in] fileName path of the cache file
+     */
+    void openHomingCache(const std::string &fileName);
+
+    /**
+     * @brief Callback of the step scan engine, called with the controller locked at every point.
+     * @param axisNo scanned axis
+     * @param point index of the point in the position list
+     * @param epos encoder position when the position was reached
+     */
+    typedef std::function<void(int axisNo, int point, int epos)> ScanCallback;
+
+    /**
+     * @brief Register a callback fired at every scan point in addition to SCAN_POINT.
+     */
+    void setScanCallback(ScanCallback callback) { scanCallback_ = callback; };
+
+    /**
+     * @brief Start a step scan through the position list of an axis.
+     * @details For every point the scan thread writes DPOS, queries STAT back to back until the position is reached,
+     * then publishes SCAN_POINT (the trigger) and waits SCAN_DWELL seconds. Only one scan per controller can run.
+     * @return false if a scan is already running, the position list is empty or a position is outside the soft limits
+     */
+    bool startScan(int axisNo);
+
+    /**
+     * @brief Stop the running scan, a move to the current point is abandoned.
+     * @details No further DPOS is sent once this returns while the controller is locked.
+     */
+    void abortScan();
+
+    /**
+     * @brief Set the positioning tolerance of an axis and update its parameter.
+     */
+    void setPositionTolerance(int axisNo, int ptol);
+
     /* ==== */
-    void setParameter(XDController *device, const std::string &cmd, const int &payload);
+    /**
+     * @brief Set a command selected at run time, access and range are checked at run time.
+     */
+    void setParameter(XDController *device, XDCmd cmd, const int &payload) { device->client_.set(cmd, payload); };
 
-    void setParameter(XDController *device, const std::string &cmd)
-    {
-        setParameter(device, cmd, 0);
-    };
+    /**
+     * @brief Set a command, access is checked at compile time, range at run time.
+     */
+    template <XDCmd cmd>
+    void setParameter(XDController *device, const int &payload) { device->client_.set<cmd>(payload); };
 
-    void getParameter(XDController *device, const std::string &cmd, int &reply);
+    /**
+     * @brief Set a command to a constant, access and range are checked at compile time.
+     */
+    template <XDCmd cmd, int32_t payload = 0>
+    void setParameter(XDController *device) { device->client_.set<cmd, payload>(); };
+
+    /**
+     * @brief Query a command selected at run time.
+     */
+    void getParameter(XDController *device, XDCmd cmd, int &reply) { reply = device->client_.get(cmd); };
+
+    /**
+     * @brief Query a command, access is checked at compile time.
+     */
+    template <XDCmd cmd>
+    void getParameter(XDController *device, int &reply) { reply = device->client_.get<cmd>(); };
 
     std::shared_ptr<XDAxis> getAxisPointer(int axisNo) { return controllerAxes.at(axisNo); };
 
-    std::array<std::shared_ptr<XDAxis>, 12> controllerAxes;
+    std::vector<std::shared_ptr<XDAxis>> controllerAxes;
+
+    /**
+     * @brief Publish the aggregate arrays of all axes.
+     * @details Called by the last axis of a poll cycle, so all arrays carry one consistent time stamp.
+     * Arrays are only published if any of their elements changed since the last cycle.
+     */
+    void publishSnapshot();
 
 private:
+    XeryonClient client_; /**< protocol layer, talks through writeController/writeReadController */
+
+    XeryonTraceRecorder traceRecorder_; /**< records traffic when a trace is running */
+    XeryonTracePlayer tracePlayer_;     /**< stands in for the controller in replay mode */
+    bool replay_ = false;               /**< replay mode, no connection to a controller */
+    XeryonHomingCache homingCache_;     /**< persistent homing state of all axes */
+    int serialNumber_ = 0;              /**< controller serial number (SRNO) */
+    /**
+     * @brief Body of the scan thread.
+     */
+    void runScan();
+
+    std::thread scanThread_;
+    std::atomic<bool> scanAbort_{false};
+    bool scanRunning_ = false;
+    int scanAxis_ = 0;
+    ScanCallback scanCallback_;
+
+    bool sharedPoller_ = false;         /**< polled by XDPollExecutor instead of an own thread */
+    size_t numQueries_ = 0;             /**< number of writeRead transactions */
+    double sumLatency_ = 0.;            /**< accumulated writeRead latency in s */
+    double maxLatency_ = 0.;            /**< largest writeRead latency in s */
+
+    XeryonStateBlock state_;           /**< status and positions of all axes, last poll */
+    bool statePublished_ = false;      /**< the arrays have been published at least once */
+
     /**
      * @brief arrays for axis letters in the controller
      * @details for future use.
@@ -110,20 +280,23 @@ private:
     */
 
 protected:
-    int statrb_; /**< axis status word readback */
-#define FIRST_XD_PARAM statrb_
-    int indx_;   /**< issue index search command */
-    int ptol_;   /**< positioning tolerance 1 */
-    int pto2_;   /**< positioning tolerance 2 */
-    int test_;   /**< test LEDs (XD-M and XD-19) */
-    int freqrb_; /**< Excitation frequency currently in use */
-    // int ofrqrb_; /**< Optimal frequency as determined by FFRQ */
-    // int currrb_; /**< Current consumed by the piezomotor */
-    int timerb_; /**< Time stamp: resolution 0.1 ms */
-    int eposrb_; /**< axis encoder readback */
-    int dposrb_; /**< axis target position readback */
-    int sspdrb_; /**< axis velocity setpoiny readback */
-#define LAST_XD_PARAM sspdrb_
+    int cmdParam_[XD_NUM_COMMANDS]; /**< asyn parameter of each command in xdCommands, -1 if it has none */
+#define FIRST_XD_PARAM cmdParam_[0]
+    int statArray_; /**< status words of all axes */
+    int eposArray_; /**< encoder positions of all axes */
+    int dposArray_; /**< target positions of all axes */
+    int velo_;      /**< estimated velocity in counts/s */
+    int remaining_; /**< distance to the final target DPOS - EPOS */
+    int settle_;    /**< time from start of the last move to position reached */
+    int overshoot_; /**< largest overshoot past the target in the last move */
+    int scanPositions_;  /**< position list of the step scan */
+    int scanDwell_;      /**< time in s to wait at every point after the trigger */
+    int scanTimeout_;    /**< time in s to reach a point before the scan is aborted */
+    int scanRun_;        /**< start / abort and busy of the step scan */
+    int scanPoint_;      /**< index of the point just reached, the detector trigger */
+    int scanReadback_;   /**< encoder positions at the points of the last scan */
+    int forgetIndex_;    /**< clear the trusted index of the homing cache */
+#define LAST_XD_PARAM forgetIndex_
 #define NUM_XD_PARAMS (&LAST_XD_PARAM - &FIRST_XD_PARAM + 1)
 
     friend class XDAxis;
@@ -152,8 +325,11 @@ public:
      * @param[in] numAxes           The number of axes that this controller supports
      * @param[in] movingPollPeriod  The time in ms between polls when any axis is moving
      * @param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+     * @param[in] replayFile        Trace file to replay instead of connecting to XDPortName, empty for normal operation
+     * @param[in] traceFile         Trace file recording all traffic from construction on, empty for none
      */
-    void addController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod);
+    void addController(const std::string &portName, const std::string &XDPortName, const uint16_t numAxes, const double movingPollPeriod, const double idlePollPeriod,
+                       const std::string &replayFile = "", const std::string &traceFile = "");
 
     /**
      * @brief Returns the controller shared_ptr under the provided name.